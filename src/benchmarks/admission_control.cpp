@@ -0,0 +1,70 @@
+#include "benchmarks/admission_control.h"
+
+#include <algorithm>
+
+namespace blocking_to_async {
+namespace testing {
+
+AdmissionStats& AdmissionStats::operator+=(const AdmissionStats& other) {
+    rejected += other.rejected;
+    shedOldest += other.shedOldest;
+    shedLate += other.shedLate;
+    return *this;
+}
+
+AdmissionStats& AdmissionStats::operator-=(const AdmissionStats& other) {
+    rejected -= other.rejected;
+    shedOldest -= other.shedOldest;
+    shedLate -= other.shedLate;
+    return *this;
+}
+
+AdmissionController::AdmissionController(const AdmissionOptions& options)
+    : _options(options) {}
+
+AdmissionController::Verdict AdmissionController::onQueue(size_t queued) {
+    if (_options.maxQueuedJobs <= 0 || queued < _options.maxQueuedJobs) {
+        return Verdict::kAdmit;
+    }
+    if (_options.overflow == AdmissionOptions::Overflow::kShedOldest && queued > 0) {
+        _shedOldest.fetch_add(1, std::memory_order_relaxed);
+        return Verdict::kShedOldest;
+    }
+    _rejected.fetch_add(1, std::memory_order_relaxed);
+    return Verdict::kReject;
+}
+
+bool AdmissionController::onDequeue(Clock::time_point queuedAt, Clock::time_point now,
+                                    size_t queued) {
+    if (!tracksDelay()) {
+        return false;
+    }
+    // The queue is overloaded when even the shortest delay of an interval, the standing
+    // queue, stays above the target ("Controlling Queue Delay", Nichols and Jacobson
+    // 2012, in the simplified form of "Fail at Scale", Maurer 2015).
+    if (now >= _intervalEnd) {
+        // The first interval starts with the first dequeue. An interval without
+        // dequeues, such as one the pool was idle in, is not overloaded.
+        bool sampled = _minDelay != Clock::duration::max() &&
+            now < _intervalEnd + _options.interval;
+        _overloaded = sampled && _minDelay > _options.targetDelay;
+        _minDelay = Clock::duration::max();
+        _intervalEnd = now + _options.interval;
+    }
+    auto delay = now - queuedAt;
+    _minDelay = std::min(_minDelay, delay);
+    auto allowed = _overloaded ? Clock::duration(_options.targetDelay)
+                               : Clock::duration(_options.interval);
+    if (delay <= allowed || queued == 0) {
+        return false;
+    }
+    _shedLate.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+AdmissionStats AdmissionController::stats() const {
+    return { _rejected.load(), _shedOldest.load(), _shedLate.load() };
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace blocking_to_async {
+namespace testing {
+
+// Limits on the admission of new work into a thread pool queue. Only jobs of
+// `JobPriority::kNormal` are subject to them, high priority jobs continue work that was
+// already admitted.
+struct AdmissionOptions {
+    enum class Overflow {
+        // The job that does not fit is shed.
+        kReject,
+        // The oldest queued job is shed to make room for the new one.
+        kShedOldest,
+    };
+
+    // Zero leaves the queue unbounded.
+    int maxQueuedJobs = 0;
+    Overflow overflow = Overflow::kReject;
+    // Queue delay target in the style of CoDel, zero disables it. While the shortest
+    // delay seen within the last `interval` exceeds the target, jobs that waited longer
+    // than the target are shed when dequeued, otherwise only those that waited longer
+    // than `interval`. The last queued job is never shed, like CoDel does not drop
+    // below one packet, so a workload whose jobs queue their successors does not die out.
+    std::chrono::microseconds targetDelay{ 0 };
+    std::chrono::microseconds interval{ 100000 };
+
+    bool enabled() const {
+        return maxQueuedJobs > 0 || targetDelay.count() > 0;
+    }
+};
+
+// Jobs shed since the pool started.
+struct AdmissionStats {
+    // Did not fit the bounded queue.
+    int64_t rejected = 0;
+    // Dropped from the head of the bounded queue for a newer job.
+    int64_t shedOldest = 0;
+    // Waited longer than the delay target allowed.
+    int64_t shedLate = 0;
+
+    int64_t shed() const {
+        return rejected + shedOldest + shedLate;
+    }
+
+    AdmissionStats& operator+=(const AdmissionStats& other);
+    AdmissionStats& operator-=(const AdmissionStats& other);
+};
+
+// Decisions of `AdmissionOptions` for one queue. Callers hold the queue lock, only
+// `stats()` may be called concurrently.
+class AdmissionController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Verdict {
+        kAdmit,
+        kReject,
+        kShedOldest,
+    };
+
+    explicit AdmissionController(const AdmissionOptions& options);
+
+    bool enabled() const {
+        return _options.enabled();
+    }
+
+    // Queued jobs need their queueing time.
+    bool tracksDelay() const {
+        return _options.targetDelay.count() > 0;
+    }
+
+    // Decides on a new job while `queued` normal priority jobs wait.
+    Verdict onQueue(size_t queued);
+
+    // True when a job queued at `queuedAt` should be shed instead of run at `now`, with
+    // `queued` normal priority jobs left behind it.
+    bool onDequeue(Clock::time_point queuedAt, Clock::time_point now, size_t queued);
+
+    AdmissionStats stats() const;
+
+private:
+    const AdmissionOptions _options;
+
+    Clock::time_point _intervalEnd;
+    Clock::duration _minDelay = Clock::duration::max();
+    bool _overloaded = false;
+
+    std::atomic<int64_t> _rejected{0};
+    std::atomic<int64_t> _shedOldest{0};
+    std::atomic<int64_t> _shedLate{0};
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -1,11 +1,14 @@
 #include <chrono>
 #include <iostream>
+#include <map>
 #include <memory>
 
 #include <benchmark/benchmark.h>
 #include <ostream>
 
 #include "benchmarks/blocking_to_async_suite.h"
+#include "benchmarks/continuous_workload.h"
+#include "benchmarks/workload_registry.h"
 
 namespace blocking_to_async {
 namespace testing {
@@ -16,6 +19,86 @@ static Config config;
 
 namespace {
 
+// Exports p50, p99 and p99.9 in microseconds of every recorded request stage.
+void reportLatencies(benchmark::State& state, const RequestLatencies& latencies) {
+    latencies.forEachStage([&](const std::string& name, const LatencyHistogram& histogram) {
+        if (histogram.count() == 0) {
+            return;
+        }
+        for (auto [suffix, percentile] : { std::pair{ "_p50_us", 50.0 },
+                                           std::pair{ "_p99_us", 99.0 },
+                                           std::pair{ "_p99.9_us", 99.9 } }) {
+            state.counters[name + suffix] =
+                std::chrono::duration<double, std::micro>(histogram.percentile(percentile)).count();
+        }
+    });
+}
+
+// Exports the perf event counters of the workload threads, hardware counters only
+// where the PMU is available.
+void reportPerfCounters(benchmark::State& state, const Stats& stats) {
+    double seconds = std::chrono::duration<double>(stats.duration).count();
+    state.counters["ctxsw"] = stats.perf.contextSwitches / seconds;
+    state.counters["cpuMigrations"] = stats.perf.cpuMigrations / seconds;
+    if (stats.perf.cycles > 0 && stats.iterations > 0) {
+        state.counters["IPC"] = double(stats.perf.instructions) / stats.perf.cycles;
+        state.counters["llcMissPerIter"] = double(stats.perf.llcMisses) / stats.iterations;
+        state.counters["dtlbMissPerIter"] = double(stats.perf.dtlbMisses) / stats.iterations;
+    }
+}
+
+// Exports the wakeup rate of parked pool workers, the share of them that found no job,
+// the average delay until a woken worker ran and the rate of jobs found by polling.
+void reportWakeups(benchmark::State& state, const Stats& stats) {
+    const auto& wakeups = stats.wakeups;
+    double seconds = std::chrono::duration<double>(stats.duration).count();
+    if (wakeups.spinHits > 0) {
+        state.counters["spinHits"] = wakeups.spinHits / seconds;
+    }
+    if (wakeups.wakeups == 0) {
+        return;
+    }
+    state.counters["wakeups"] = wakeups.wakeups / seconds;
+    state.counters["spuriousWakeupRatio"] = double(wakeups.spuriousWakeups) / wakeups.wakeups;
+    state.counters["timeToWake_us"] =
+        std::chrono::duration<double, std::micro>(wakeups.timeToWake).count() / wakeups.wakeups;
+}
+
+// Exports the rates of jobs shed by admission control, by reason.
+void reportAdmission(benchmark::State& state, const Stats& stats) {
+    const auto& admission = stats.admission;
+    if (admission.shed() == 0) {
+        return;
+    }
+    double seconds = std::chrono::duration<double>(stats.duration).count();
+    state.counters["rejected"] = admission.rejected / seconds;
+    state.counters["shedOldest"] = admission.shedOldest / seconds;
+    state.counters["shedLate"] = admission.shedLate / seconds;
+}
+
+// Exports where the time of the workload threads went between the two snapshots, per
+// workload type or pool: average count of threads on a CPU, waiting for a CPU and
+// off CPU, and context switches per second.
+void reportSchedStats(benchmark::State& state,
+                      const std::map<std::string, SchedStats>& before,
+                      const std::map<std::string, SchedStats>& after,
+                      std::chrono::microseconds duration) {
+    double seconds = std::chrono::duration<double>(duration).count();
+    for (auto [name, stats] : after) {
+        if (auto it = before.find(name); it != before.end()) {
+            stats -= it->second;
+        }
+        auto perSecond = [seconds](std::chrono::nanoseconds time) {
+            return std::chrono::duration<double>(time).count() / seconds;
+        };
+        state.counters[name + "_onCpu"] = perSecond(stats.onCpu);
+        state.counters[name + "_runQueue"] = perSecond(stats.runQueueWait);
+        state.counters[name + "_offCpu"] = perSecond(stats.offCpu());
+        state.counters[name + "_nvcsw"] = stats.voluntarySwitches / seconds;
+        state.counters[name + "_nivcsw"] = stats.involuntarySwitches / seconds;
+    }
+}
+
 void percentBlockingCustomArguments(benchmark::internal::Benchmark* b) {
     std::vector<int> threadCount{ 
         8, 12, 16, 20, 32, 44, 64, 80, 100, 120
@@ -34,13 +117,13 @@ void percentBlockingCustomArguments(benchmark::internal::Benchmark* b) {
     b->Iterations(2000);
 }
 
-void BM_percentBlocking(benchmark::State& state) {
-    ContinuousWorkload mainThreadWorkload;
-    mainThreadWorkload.init(config);
+void runPercentBlockingBenchmark(benchmark::State& state, const BlockingCallOptions& blockingCall) {
+    auto mainThreadWorkload = WorkloadRegistry::instance().create(config);
 
     // Remove unblocked threads and pooled workload.
     mtWorkload->scaleNonBlockingWorkloadTo(0);
     mtWorkload->stopPooledWorkload();
+    mtWorkload->setBlockingCall(blockingCall);
 
     assert(state.range(0) >= 0 && state.range(0) <= 99);
     mtWorkload->resetBlockingWorkflowTo(
@@ -50,19 +133,50 @@ void BM_percentBlocking(benchmark::State& state) {
     mtWorkload->resetStats();
 
     auto statsBefore = mtWorkload->getStats();
+    auto schedBefore = mtWorkload->getSchedStats();
     std::cerr<<"before "<<statsBefore<<std::endl;
     for (auto _ : state) {
-        mainThreadWorkload.unitOfWork();
+        mainThreadWorkload->unitOfWork();
     }
     auto statsAfter = mtWorkload->getStats().diff(statsBefore);
     std::cerr<<"after "<<statsAfter<<std::endl;
     state.counters["qps"] = statsAfter.qps();
     state.counters["minflt"] = statsAfter.minfltQps();
     state.counters["Migrations"] = statsAfter.migrationsQps();
+    reportPerfCounters(state, statsAfter);
+    reportSchedStats(state, schedBefore, mtWorkload->getSchedStats(), statsAfter.duration);
+    reportLatencies(state, mtWorkload->getLatencies());
+}
+
+void BM_percentBlocking(benchmark::State& state) {
+    runPercentBlockingBenchmark(state, BlockingCallOptions());
 }
 
 BENCHMARK(BM_percentBlocking)->Apply(percentBlockingCustomArguments);
 
+// Blocking calls are a random 4 KiB read of the data file instead of a sleep, the same
+// on the thread and async backends, so they block for as long as the storage takes.
+// Without `directIo` the file is evicted from the page cache before the run.
+BlockingCallOptions diskReadBlockingCall(bool directIo = false) {
+    BlockingCallOptions blockingCall;
+    blockingCall.kind = BlockingCallOptions::Kind::kDiskRead;
+    blockingCall.diskRead.directIo = directIo;
+    return blockingCall;
+}
+
+void BM_percentBlockingDiskRead(benchmark::State& state) {
+    runPercentBlockingBenchmark(state, diskReadBlockingCall());
+}
+
+BENCHMARK(BM_percentBlockingDiskRead)->Apply(percentBlockingCustomArguments);
+
+// Reads bypass the page cache with `O_DIRECT` and reach the device.
+void BM_percentBlockingDiskReadDirect(benchmark::State& state) {
+    runPercentBlockingBenchmark(state, diskReadBlockingCall(true));
+}
+
+BENCHMARK(BM_percentBlockingDiskReadDirect)->Apply(percentBlockingCustomArguments);
+
 void pooledCustomArguments(benchmark::internal::Benchmark* b) {
     std::vector<int> threadCount{ 
         1, 4, 8, 12, 13, 14, 15, 16, 20, 32
@@ -81,59 +195,494 @@ void pooledCustomArguments(benchmark::internal::Benchmark* b) {
     b->Iterations(2000);
 }
 
-void BM_pooledBlocks(benchmark::State& state) {
-    ContinuousWorkload mainThreadWorkload;
-    mainThreadWorkload.init(config);
+// Shared measurement of the pooled benchmarks. `startWorkload` receives the thread
+// count, blocking ratio and iterations before sleep from the benchmark arguments.
+void runPooledBenchmark(
+    benchmark::State& state,
+    const std::function<void(int, double, int)>& startWorkload,
+    const BlockingCallOptions& blockingCall = BlockingCallOptions()) {
+    auto mainThreadWorkload = WorkloadRegistry::instance().create(config);
 
     // Remove unblocked threads and pooled workload.
     mtWorkload->scaleNonBlockingWorkloadTo(0);
     mtWorkload->stopPooledWorkload();
     mtWorkload->resetBlockingWorkflowTo(0, 0, 0);
+    mtWorkload->setBlockingCall(blockingCall);
 
     assert(state.range(0) >= 0 && state.range(0) <= 99);
-    mtWorkload->startPooledWorkload(
-        state.range(2), 
+    startWorkload(
+        state.range(2),
         (state.range(0) / 100.),  // Percentage into ratio.
         state.range(1));
     mtWorkload->resetStats();
 
     auto statsBefore = mtWorkload->getStats();
+    auto schedBefore = mtWorkload->getSchedStats();
     std::cerr<<"before "<<statsBefore<<std::endl;
     for (auto _ : state) {
-        mainThreadWorkload.unitOfWork();
+        mainThreadWorkload->unitOfWork();
     }
     auto statsAfter = mtWorkload->getStats().diff(statsBefore);
     std::cerr<<"after "<<statsAfter<<" "<<mtWorkload->status()<<std::endl;
     state.counters["qps"] = statsAfter.qps();
     state.counters["minflt"] = statsAfter.minfltQps();
     state.counters["Migrations"] = statsAfter.migrationsQps();
+    state.counters["spawned"] = statsAfter.threadsSpawned;
+    state.counters["retired"] = statsAfter.threadsRetired;
+    reportWakeups(state, statsAfter);
+    reportAdmission(state, statsAfter);
+    reportPerfCounters(state, statsAfter);
+    reportSchedStats(state, schedBefore, mtWorkload->getSchedStats(), statsAfter.duration);
+    reportLatencies(state, mtWorkload->getLatencies());
+}
+
+void runPooledBenchmark(benchmark::State& state,
+                        const PooledWorkloadConfig& poolConfig,
+                        const BlockingCallOptions& blockingCall = BlockingCallOptions()) {
+    runPooledBenchmark(state, [&](int threadCount, double ratio, int iterations) {
+        mtWorkload->startPooledWorkload(threadCount, ratio, iterations, poolConfig);
+    }, blockingCall);
+}
+
+void BM_pooledBlocks(benchmark::State& state) {
+    runPooledBenchmark(state, PooledWorkloadConfig());
 }
 
 BENCHMARK(BM_pooledBlocks)->Apply(pooledCustomArguments);
 
+void BM_pooledBlocksDiskRead(benchmark::State& state) {
+    runPooledBenchmark(state, PooledWorkloadConfig(), diskReadBlockingCall());
+}
+
+BENCHMARK(BM_pooledBlocksDiskRead)->Apply(pooledCustomArguments);
+
+void BM_pooledBlocksDiskReadDirect(benchmark::State& state) {
+    runPooledBenchmark(state, PooledWorkloadConfig(), diskReadBlockingCall(true));
+}
+
+BENCHMARK(BM_pooledBlocksDiskReadDirect)->Apply(pooledCustomArguments);
+
+// Both pools use per-worker work stealing deques instead of the shared queue.
+void BM_pooledBlocksWorkStealing(benchmark::State& state) {
+    PooledWorkloadConfig poolConfig;
+    poolConfig.unblockedPool.scheduler = ThreadPoolOptions::Scheduler::kWorkStealing;
+    poolConfig.blockingPool.scheduler = ThreadPoolOptions::Scheduler::kWorkStealing;
+    runPooledBenchmark(state, poolConfig);
+}
+
+BENCHMARK(BM_pooledBlocksWorkStealing)->Apply(pooledCustomArguments);
+
+// The blocking calls pool starts with one thread and grows up to the fixed pool size
+// when jobs wait behind busy threads, idle threads retire.
+void BM_pooledBlocksElastic(benchmark::State& state) {
+    PooledWorkloadConfig poolConfig;
+    poolConfig.blockingPool.scheduler = ThreadPoolOptions::Scheduler::kElastic;
+    runPooledBenchmark(state, poolConfig);
+}
+
+BENCHMARK(BM_pooledBlocksElastic)->Apply(pooledCustomArguments);
+
+// Both pools are sharded by topology domain with pinned workers, continuations of the
+// blocking calls return to the shard that issued them.
+void runPinnedPooledBenchmark(benchmark::State& state, ThreadPoolOptions::Pinning pinning) {
+    PooledWorkloadConfig poolConfig;
+    poolConfig.unblockedPool.pinning = pinning;
+    poolConfig.blockingPool.pinning = pinning;
+    runPooledBenchmark(state, poolConfig);
+}
+
+void BM_pooledBlocksPinnedPerCore(benchmark::State& state) {
+    runPinnedPooledBenchmark(state, ThreadPoolOptions::Pinning::kPerCore);
+}
+
+BENCHMARK(BM_pooledBlocksPinnedPerCore)->Apply(pooledCustomArguments);
+
+void BM_pooledBlocksPinnedPerLlc(benchmark::State& state) {
+    runPinnedPooledBenchmark(state, ThreadPoolOptions::Pinning::kPerLlc);
+}
+
+BENCHMARK(BM_pooledBlocksPinnedPerLlc)->Apply(pooledCustomArguments);
+
+void BM_pooledBlocksPinnedPerNumaNode(benchmark::State& state) {
+    runPinnedPooledBenchmark(state, ThreadPoolOptions::Pinning::kPerNumaNode);
+}
+
+BENCHMARK(BM_pooledBlocksPinnedPerNumaNode)->Apply(pooledCustomArguments);
+
+// Blocking calls are timers of one reactor thread instead of parked pool threads.
+void BM_pooledBlocksTimerReactor(benchmark::State& state) {
+    PooledWorkloadConfig poolConfig;
+    poolConfig.blockingBackend = PooledWorkloadConfig::BlockingBackend::kTimerReactor;
+    runPooledBenchmark(state, poolConfig);
+}
+
+BENCHMARK(BM_pooledBlocksTimerReactor)->Apply(pooledCustomArguments);
+
+// Timer reactor whose expired timers queue their continuations as one batch per tick,
+// workers take up to 8 jobs per visit of the shared queue.
+void BM_pooledBlocksBatched(benchmark::State& state) {
+    PooledWorkloadConfig poolConfig;
+    poolConfig.blockingBackend = PooledWorkloadConfig::BlockingBackend::kTimerReactor;
+    poolConfig.unblockedPool.dequeueBatch = 8;
+    runPooledBenchmark(state, poolConfig);
+}
+
+BENCHMARK(BM_pooledBlocksBatched)->Apply(pooledCustomArguments);
+
+// Continuations of finished blocking calls overtake queued admissions of new work.
+void BM_pooledBlocksPrioritized(benchmark::State& state) {
+    PooledWorkloadConfig poolConfig;
+    poolConfig.prioritizeContinuations = true;
+    runPooledBenchmark(state, poolConfig);
+}
+
+BENCHMARK(BM_pooledBlocksPrioritized)->Apply(pooledCustomArguments);
+
+void lifoSlotCustomArguments(benchmark::internal::Benchmark* b) {
+    std::vector<int> threadCount{ 1, 4, 16 };
+
+    for (int threads : threadCount) {
+        for (int lifoSlot : { 0, 1 }) {
+            b->Args({80, 1, threads, lifoSlot});
+        }
+    }
+    b->Iterations(2000);
+}
+
+// Requests compute in 4 stages, each queued by the worker that ran the previous one,
+// through the FIFO queue or, with argument 4 set, the worker's next job slot. Compare
+// Migrations and the compute queue wait latencies.
+void BM_pooledBlocksLifoSlot(benchmark::State& state) {
+    PooledWorkloadConfig poolConfig;
+    poolConfig.computeStages = 4;
+    poolConfig.unblockedPool.lifoSlot = state.range(3) != 0;
+    runPooledBenchmark(state, poolConfig);
+}
+
+BENCHMARK(BM_pooledBlocksLifoSlot)->Apply(lifoSlotCustomArguments);
+
+void idleCustomArguments(benchmark::internal::Benchmark* b) {
+    std::vector<int> threadCount{ 4, 16 };
+    // Spin and yield budgets of idle workers in microseconds.
+    std::vector<std::pair<int, int>> budgets{
+        { 0, 0 }, { 5, 0 }, { 20, 0 }, { 100, 0 }, { 0, 20 }, { 0, 100 }, { 20, 100 }
+    };
+
+    for (int threads : threadCount) {
+        for (auto [spin, yield] : budgets) {
+            b->Args({80, 1, threads, spin, yield});
+        }
+    }
+    b->Iterations(2000);
+}
+
+// Idle compute workers poll the queue for the spin and yield budgets of arguments 4
+// and 5 before parking. Compare spinHits and the onCpu time of the pool against the
+// wakeup counters and latencies.
+void BM_pooledBlocksSpinning(benchmark::State& state) {
+    PooledWorkloadConfig poolConfig;
+    poolConfig.unblockedPool.idle.spinFor = std::chrono::microseconds(state.range(3));
+    poolConfig.unblockedPool.idle.yieldFor = std::chrono::microseconds(state.range(4));
+    runPooledBenchmark(state, poolConfig);
+}
+
+BENCHMARK(BM_pooledBlocksSpinning)->Apply(idleCustomArguments);
+
+enum class AdmissionPolicy {
+    // The workload stops admitting while the queue outgrows the idle workers.
+    kAdHoc,
+    kBoundedReject,
+    kBoundedShedOldest,
+    kCoDel,
+};
+
+void admissionCustomArguments(benchmark::internal::Benchmark* b) {
+    std::vector<int> threadCount{ 4, 16 };
+    std::vector<AdmissionPolicy> policies{
+        AdmissionPolicy::kAdHoc, AdmissionPolicy::kBoundedReject,
+        AdmissionPolicy::kBoundedShedOldest, AdmissionPolicy::kCoDel,
+    };
+
+    for (int threads : threadCount) {
+        for (auto policy : policies) {
+            b->Args({80, 1, threads, static_cast<int>(policy)});
+        }
+    }
+    b->Iterations(2000);
+}
+
+// The compute pool sheds new work by the policy of argument 4 instead of the workload
+// checking the queue size: a queue bounded to 4 jobs per thread that rejects or sheds
+// the oldest job, or a 1 ms queueing delay target over 10 ms intervals. Compare qps, the
+// shed rates and the compute queue wait latencies.
+void BM_pooledBlocksAdmission(benchmark::State& state) {
+    PooledWorkloadConfig poolConfig;
+    auto& admission = poolConfig.unblockedPool.admission;
+    switch (static_cast<AdmissionPolicy>(state.range(3))) {
+    case AdmissionPolicy::kAdHoc:
+        break;
+    case AdmissionPolicy::kBoundedReject:
+        admission.maxQueuedJobs = state.range(2) * 4;
+        break;
+    case AdmissionPolicy::kBoundedShedOldest:
+        admission.maxQueuedJobs = state.range(2) * 4;
+        admission.overflow = AdmissionOptions::Overflow::kShedOldest;
+        break;
+    case AdmissionPolicy::kCoDel:
+        admission.targetDelay = std::chrono::milliseconds(1);
+        admission.interval = std::chrono::milliseconds(10);
+        break;
+    }
+    runPooledBenchmark(state, poolConfig);
+}
+
+BENCHMARK(BM_pooledBlocksAdmission)->Apply(admissionCustomArguments);
+
+// Blocking calls are io_uring timeouts reaped by one thread.
+void BM_pooledBlocksIoUring(benchmark::State& state) {
+    if (!IoUringReactor::isSupported()) {
+        state.SkipWithError("io_uring is not available");
+        return;
+    }
+    PooledWorkloadConfig poolConfig;
+    poolConfig.blockingBackend = PooledWorkloadConfig::BlockingBackend::kIoUring;
+    runPooledBenchmark(state, poolConfig);
+}
+
+BENCHMARK(BM_pooledBlocksIoUring)->Apply(pooledCustomArguments);
+
+// Blocking calls are 4 KiB io_uring reads of the data file, the time spent blocked is
+// whatever the storage stack takes instead of the computed sleep.
+void BM_pooledBlocksIoUringRead(benchmark::State& state) {
+    if (!IoUringReactor::isSupported()) {
+        state.SkipWithError("io_uring is not available");
+        return;
+    }
+    PooledWorkloadConfig poolConfig;
+    poolConfig.blockingBackend = PooledWorkloadConfig::BlockingBackend::kIoUring;
+    runPooledBenchmark(state, poolConfig, diskReadBlockingCall());
+}
+
+BENCHMARK(BM_pooledBlocksIoUringRead)->Apply(pooledCustomArguments);
+
+void BM_pooledBlocksIoUringReadDirect(benchmark::State& state) {
+    if (!IoUringReactor::isSupported()) {
+        state.SkipWithError("io_uring is not available");
+        return;
+    }
+    PooledWorkloadConfig poolConfig;
+    poolConfig.blockingBackend = PooledWorkloadConfig::BlockingBackend::kIoUring;
+    runPooledBenchmark(state, poolConfig, diskReadBlockingCall(true));
+}
+
+BENCHMARK(BM_pooledBlocksIoUringReadDirect)->Apply(pooledCustomArguments);
+
+void connectionsCustomArguments(benchmark::internal::Benchmark* b) {
+    std::vector<int> backends{
+        static_cast<int>(PooledWorkloadConfig::BlockingBackend::kThreadPool),
+        static_cast<int>(PooledWorkloadConfig::BlockingBackend::kTimerReactor),
+    };
+    std::vector<int> connections{
+        1000, 10000, 100000, 1000000
+    };
+
+    for (int backend : backends) {
+        for (int connectionCount : connections) {
+            b->Args({backend, connectionCount});
+        }
+    }
+    b->Iterations(2000);
+}
+
+// Arguments: blocking backend and count of logical connections. Every connection keeps
+// one 80% blocking request of one unit of work in flight on the pooled workload with
+// the calibrated thread count, the thread count does not grow with the connections.
+// Memory per connection is the growth of the malloc heap once all connections are busy.
+void BM_pooledConnections(benchmark::State& state) {
+    auto mainThreadWorkload = WorkloadRegistry::instance().create(config);
+
+    mtWorkload->scaleNonBlockingWorkloadTo(0);
+    mtWorkload->stopPooledWorkload();
+    mtWorkload->resetBlockingWorkflowTo(0, 0, 0);
+    mtWorkload->setBlockingCall(BlockingCallOptions());
+
+    PooledWorkloadConfig poolConfig;
+    poolConfig.blockingBackend =
+        static_cast<PooledWorkloadConfig::BlockingBackend>(state.range(0));
+    poolConfig.connections = state.range(1);
+    auto [heapBefore, rssBefore] = Stats::getMemoryUsage();
+    mtWorkload->startPooledWorkload(
+        std::max(1, config.optimalConcurrency.threadCount), 0.8, 1, poolConfig);
+    mtWorkload->resetStats();
+
+    auto statsBefore = mtWorkload->getStats();
+    auto schedBefore = mtWorkload->getSchedStats();
+    for (auto _ : state) {
+        mainThreadWorkload->unitOfWork();
+    }
+    auto statsAfter = mtWorkload->getStats().diff(statsBefore);
+    auto [heapAfter, rssAfter] = Stats::getMemoryUsage();
+    std::cerr << "after " << statsAfter << " " << mtWorkload->status() << std::endl;
+    state.counters["qps"] = statsAfter.qps();
+    state.counters["bytesPerConnection"] =
+        (double(heapAfter) - double(heapBefore)) / poolConfig.connections;
+    state.counters["rssMiB"] = rssAfter / double(1 << 20);
+    reportPerfCounters(state, statsAfter);
+    reportSchedStats(state, schedBefore, mtWorkload->getSchedStats(), statsAfter.duration);
+    reportLatencies(state, mtWorkload->getLatencies());
+}
+
+BENCHMARK(BM_pooledConnections)->Apply(connectionsCustomArguments);
+
+// Same request mix written as coroutines, with as many requests in flight as the
+// blocking pool of `BM_pooledBlocks` has threads.
+void BM_coroutineBlocks(benchmark::State& state) {
+    runPooledBenchmark(state, [](int threadCount, double ratio, int iterations) {
+        mtWorkload->startCoroutineWorkload(
+            threadCount, ratio, iterations, std::min(threadCount * 20, 800));
+    });
+}
+
+BENCHMARK(BM_coroutineBlocks)->Apply(pooledCustomArguments);
+
+// Same request mix as straight line blocking code on fibers, as many as the coroutines
+// above, over carrier threads pinned per core. The blocking call suspends the fiber on
+// the timer reactor instead of parking a thread.
+void BM_fiberBlocks(benchmark::State& state) {
+    runPooledBenchmark(state, [](int threadCount, double ratio, int iterations) {
+        mtWorkload->startFiberWorkload(
+            threadCount, ratio, iterations, std::min(threadCount * 20, 800));
+    });
+}
+
+BENCHMARK(BM_fiberBlocks)->Apply(pooledCustomArguments);
+
+// Blocking calls are reads of the data file submitted to io_uring by the fibers.
+void BM_fiberBlocksDiskRead(benchmark::State& state) {
+    runPooledBenchmark(state, [](int threadCount, double ratio, int iterations) {
+        mtWorkload->startFiberWorkload(
+            threadCount, ratio, iterations, std::min(threadCount * 20, 800));
+    }, diskReadBlockingCall());
+}
+
+BENCHMARK(BM_fiberBlocksDiskRead)->Apply(pooledCustomArguments);
+
+void openLoopCustomArguments(benchmark::internal::Benchmark* b) {
+    std::vector<int> models{
+        static_cast<int>(OpenLoopOptions::Model::kDedicatedThreads),
+        static_cast<int>(OpenLoopOptions::Model::kPooled),
+        static_cast<int>(OpenLoopOptions::Model::kCoroutine),
+    };
+    // Offered load in percent of the calibrated capacity.
+    std::vector<int> loads{ 25, 50, 75, 90, 100, 110, 125, 150 };
+
+    for (int model : models) {
+        for (int load : loads) {
+            b->Args({model, load});
+        }
+    }
+    b->Iterations(2000);
+}
+
+// Arguments: thread model and offered load. Requests are 80% blocking with one unit of
+// work and arrive at a rate independent of completions, the capacity is the calibrated
+// QPS. The compute pools have the calibrated thread count, dedicated threads 5 times
+// more so that they can keep the CPUs busy while blocked.
+void runOpenLoopBenchmark(benchmark::State& state, OpenLoopOptions::Arrivals arrivals) {
+    static constexpr double kRatioOfTimeToBlock = 0.8;
+    static constexpr int kIterationsPerRequest = 1;
+    if (config.optimalConcurrency.qps <= 0) {
+        state.SkipWithError("no calibrated capacity");
+        return;
+    }
+    auto mainThreadWorkload = WorkloadRegistry::instance().create(config);
+
+    mtWorkload->scaleNonBlockingWorkloadTo(0);
+    mtWorkload->stopPooledWorkload();
+    mtWorkload->resetBlockingWorkflowTo(0, 0, 0);
+    mtWorkload->setBlockingCall(BlockingCallOptions());
+
+    OpenLoopOptions options;
+    options.model = static_cast<OpenLoopOptions::Model>(state.range(0));
+    options.arrivals = arrivals;
+    options.requestsPerSecond =
+        config.optimalConcurrency.qps * state.range(1) / 100. / kIterationsPerRequest;
+    int threadCount = std::max(1, config.optimalConcurrency.threadCount);
+    if (options.model == OpenLoopOptions::Model::kDedicatedThreads) {
+        threadCount = std::min(threadCount * 5, 800);
+    }
+    mtWorkload->startOpenLoopWorkload(
+        threadCount, kRatioOfTimeToBlock, kIterationsPerRequest, options);
+    mtWorkload->resetStats();
+
+    auto schedBefore = mtWorkload->getSchedStats();
+    for (auto _ : state) {
+        mainThreadWorkload->unitOfWork();
+    }
+    auto stats = mtWorkload->getStats();
+    auto openLoop = mtWorkload->getOpenLoopStats();
+    std::cerr << "after " << stats << " " << mtWorkload->status() << std::endl;
+    double seconds = std::chrono::duration<double>(openLoop.duration).count();
+    state.counters["offered_rps"] = options.requestsPerSecond;
+    state.counters["arrivals"] = openLoop.offered / seconds;
+    state.counters["throughput"] = openLoop.completed / seconds;
+    state.counters["dropped"] = openLoop.dropped / seconds;
+    state.counters["qps"] = stats.qps();
+    reportPerfCounters(state, stats);
+    reportSchedStats(state, schedBefore, mtWorkload->getSchedStats(), stats.duration);
+    reportLatencies(state, mtWorkload->getLatencies());
+    mtWorkload->stopPooledWorkload();
+}
+
+void BM_openLoop(benchmark::State& state) {
+    runOpenLoopBenchmark(state, OpenLoopOptions::Arrivals::kPoisson);
+}
+
+BENCHMARK(BM_openLoop)->Apply(openLoopCustomArguments);
+
+// Same mean arrival rate in bursts of 16 requests.
+void BM_openLoopBursty(benchmark::State& state) {
+    runOpenLoopBenchmark(state, OpenLoopOptions::Arrivals::kBursty);
+}
+
+BENCHMARK(BM_openLoopBursty)->Apply(openLoopCustomArguments);
+
 }  // namespace
 }  // namespace testing
 }  // namespace blocking_to_async
 
 using blocking_to_async::testing::Calibration;
+using blocking_to_async::testing::CalibrationOptions;
 using blocking_to_async::testing::ContinuousWorkload;
 using blocking_to_async::testing::MultithreadedWorkload;
+using blocking_to_async::testing::WorkloadRegistry;
 
 int main(int argc, char** argv)
 {
     {
-        auto calibration = std::make_unique<Calibration>();
+        // Our flags must be gone before the benchmark library parses the rest.
+        auto& config = blocking_to_async::testing::config;
+        config.workload = WorkloadRegistry::workloadFromCommandLine(&argc, argv);
+        if (!ContinuousWorkload::flagsFromCommandLine(&argc, argv, &config)) {
+            return 1;
+        }
+        if (!WorkloadRegistry::instance().contains(config.workload)) {
+            std::cerr << "Unknown workload " << config.workload << ", available:";
+            for (const auto& name : WorkloadRegistry::instance().names()) {
+                std::cerr << " " << name;
+            }
+            std::cerr << std::endl;
+            return 1;
+        }
+        auto calibration = std::make_unique<Calibration>(
+            CalibrationOptions::fromCommandLine(&argc, argv));
         blocking_to_async::testing::mtWorkload = std::make_unique<MultithreadedWorkload>(
             [] { 
-                auto workload = std::make_unique<ContinuousWorkload>();
-                workload->init(blocking_to_async::testing::config);
-                return workload;
+                return WorkloadRegistry::instance().create(blocking_to_async::testing::config);
             }
         );
-        blocking_to_async::testing::config.optimalConcurrency =
-            calibration->calibrate(
-                blocking_to_async::testing::config, 
-                blocking_to_async::testing::mtWorkload.get());
+        config.optimalConcurrency =
+            calibration->calibrate(config, blocking_to_async::testing::mtWorkload.get());
     }
 
     ::benchmark::Initialize(&argc, argv);
@@ -1,17 +1,251 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <ostream>
+#include <sstream>
+#include <vector>
 
 #include "benchmarks/blocking_to_async_suite.h"
 
 namespace blocking_to_async {
 namespace testing {
 
+namespace {
+
+// Two sided 97.5% quantiles of the Student's t distribution by degrees of freedom.
+double studentT975(int degreesOfFreedom) {
+    static const double kQuantiles[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    };
+    if (degreesOfFreedom < std::size(kQuantiles)) {
+        return kQuantiles[degreesOfFreedom];
+    }
+    return 1.96;
+}
+
+std::string cpuModel() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            auto value = line.substr(line.find(':') + 1);
+            return value.substr(value.find_first_not_of(' '));
+        }
+    }
+    return "unknown";
+}
+
+// Cache lines are "<key>\t<thread count>\t<qps>".
+bool readCache(const std::string& path, const std::string& key, OptimalConcurrency* result) {
+    std::ifstream cache(path);
+    std::string line;
+    while (std::getline(cache, line)) {
+        std::istringstream iss(line);
+        std::string lineKey;
+        if (std::getline(iss, lineKey, '\t') && lineKey == key &&
+            iss >> result->threadCount >> result->qps) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeCache(const std::string& path, const std::string& key, const OptimalConcurrency& result) {
+    std::vector<std::string> lines;
+    {
+        std::ifstream cache(path);
+        std::string line;
+        while (std::getline(cache, line)) {
+            if (line.rfind(key + "\t", 0) != 0) {
+                lines.push_back(line);
+            }
+        }
+    }
+    std::ofstream cache(path, std::ios::trunc);
+    for (const auto& line : lines) {
+        cache << line << "\n";
+    }
+    cache << key << "\t" << result.threadCount << "\t" << result.qps << "\n";
+    if (!cache) {
+        std::cerr << "Failed to write calibration cache " << path << std::endl;
+    }
+}
+
+}  // namespace
+
+CalibrationOptions CalibrationOptions::fromCommandLine(int* argc, char** argv) {
+    CalibrationOptions options;
+    options.cachePath =
+        (std::filesystem::temp_directory_path() / "blocking_to_async_calibration.cache").string();
+
+    int kept = 1;
+    for (int i = 1; i < *argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--calibration=linear") {
+            options.method = Method::kLinear;
+        } else if (arg == "--calibration=search") {
+            options.method = Method::kSearch;
+        } else if (arg.rfind("--calibration_cache=", 0) == 0) {
+            options.cachePath = arg.substr(strlen("--calibration_cache="));
+        } else if (arg == "--recalibrate") {
+            options.recalibrate = true;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    *argc = kept;
+    return options;
+}
+
+Calibration::Calibration(const CalibrationOptions& options) : _options(options) {}
+
 OptimalConcurrency Calibration::calibrate(
     const Config& config,
     MultithreadedWorkload *mtWorkload) {
+    auto key = _cacheKey(config);
+    OptimalConcurrency result;
+    if (!_options.cachePath.empty() && !_options.recalibrate &&
+        readCache(_options.cachePath, key, &result)) {
+        std::cerr << "Using cached calibration with thread count " << result.threadCount
+            << " and QPS " << result.qps << " from " << _options.cachePath << std::endl;
+        return result;
+    }
+
     mtWorkload->scaleNonBlockingWorkloadTo(0);
     std::cerr << "Start calibration" << std::endl;
+    switch (_options.method) {
+    case CalibrationOptions::Method::kSearch:
+        result = _calibrateSearch(mtWorkload);
+        break;
+    case CalibrationOptions::Method::kLinear:
+        result = _calibrateLinear(mtWorkload);
+        break;
+    }
+    // Stop all the jobs.
+    mtWorkload->scaleNonBlockingWorkloadTo(0);
+
+    if (!_options.cachePath.empty()) {
+        writeCache(_options.cachePath, key, result);
+    }
+    return result;
+}
+
+std::string Calibration::_cacheKey(const Config& config) const {
+    std::ostringstream key;
+    key << "cpu=" << cpuModel() << ";cores=" << std::thread::hardware_concurrency()
+        << ";workload=" << config.workload
+        << ";sharedDataSize=" << config.sharedDataSize
+        << ";memoryWorkSizePerIteration=" << config.memoryWorkSizePerIteration
+        << ";sharedData=" << static_cast<int>(config.sharedData)
+        << ";arenaPages=" << static_cast<int>(config.arena.pages)
+        << ";arenaFragmentBytes=" << config.arena.fragmentBytes
+        << ";shardLock=" << lockKindName(config.shardLock)
+        << ";method=" << static_cast<int>(_options.method);
+    return key.str();
+}
+
+const Calibration::Measurement& Calibration::_measure(
+    MultithreadedWorkload *mtWorkload, int threadCount) {
+    if (auto it = _measurements.find(threadCount); it != _measurements.end()) {
+        return it->second;
+    }
+    mtWorkload->scaleNonBlockingWorkloadTo(threadCount);
+
+    // The first sample after a change of the thread count is discarded.
+    std::vector<double> samples;
+    Measurement measurement;
+    for (int i = 0; i <= _options.maxSamples; ++i) {
+        mtWorkload->resetStats();
+        std::this_thread::sleep_for(_options.sampleDuration);
+        if (i == 0) {
+            continue;
+        }
+        samples.push_back(mtWorkload->getStats().qps());
+        if (samples.size() < std::max(2, _options.minSamples)) {
+            continue;
+        }
+
+        double mean = 0;
+        for (double qps : samples) {
+            mean += qps;
+        }
+        mean /= samples.size();
+        double variance = 0;
+        for (double qps : samples) {
+            variance += (qps - mean) * (qps - mean);
+        }
+        variance /= samples.size() - 1;
+        measurement.qps = mean;
+        measurement.halfWidth =
+            studentT975(samples.size() - 1) * std::sqrt(variance / samples.size());
+        if (measurement.halfWidth <= mean * _options.relativeConfidence) {
+            break;
+        }
+    }
+
+    std::cerr << "Thread count " << threadCount << " QPS " << measurement.qps << " +- "
+        << measurement.halfWidth << " from " << samples.size() << " samples" << std::endl;
+    return _measurements[threadCount] = measurement;
+}
+
+OptimalConcurrency Calibration::_calibrateSearch(MultithreadedWorkload *mtWorkload) {
+    int maxThreads = _options.maxThreads > 0 ? _options.maxThreads
+                                             : 32 * std::max(1u, std::thread::hardware_concurrency());
+
+    // Double the thread count until the QPS is no longer significantly higher, the
+    // optimum is then between half of the best count and the first count past it.
+    int best = 1;
+    int upper = 1;
+    while (upper < maxThreads) {
+        upper = std::min(upper * 2, maxThreads);
+        const auto& bestMeasurement = _measure(mtWorkload, best);
+        if (_measure(mtWorkload, upper).qps <= bestMeasurement.qps + bestMeasurement.halfWidth) {
+            break;
+        }
+        best = upper;
+    }
+    int lower = std::max(1, best / 2);
+
+    // Golden-section search for the maximum over the integer thread counts.
+    constexpr double kInversePhi = 0.6180339887498949;
+    while (upper - lower > 2) {
+        int left = upper - std::lround((upper - lower) * kInversePhi);
+        int right = lower + std::lround((upper - lower) * kInversePhi);
+        if (left >= right) {
+            left = right - 1;
+        }
+        if (_measure(mtWorkload, left).qps >= _measure(mtWorkload, right).qps) {
+            upper = right;
+        } else {
+            lower = left;
+        }
+    }
+
+    // On a plateau the smallest thread count whose QPS cannot be told apart from the
+    // best one wins, more threads only add context switches.
+    const auto& [bestThreadCount, bestMeasurement] = *std::max_element(
+        _measurements.begin(), _measurements.end(),
+        [](const auto& a, const auto& b) { return a.second.qps < b.second.qps; });
+    OptimalConcurrency result{ bestThreadCount, bestMeasurement.qps };
+    for (const auto& [threadCount, measurement] : _measurements) {
+        if (measurement.qps + measurement.halfWidth >=
+            bestMeasurement.qps - bestMeasurement.halfWidth) {
+            result = { threadCount, measurement.qps };
+            break;
+        }
+    }
+    std::cerr << "Done calibrating with thread count " << result.threadCount
+        << " and QPS " << result.qps << " after " << _measurements.size()
+        << " measured thread counts" << std::endl;
+    return result;
+}
+
+OptimalConcurrency Calibration::_calibrateLinear(MultithreadedWorkload *mtWorkload) {
     mtWorkload->scaleNonBlockingWorkloadTo(1);
 
     double previousCycleQPS = 0;
@@ -33,7 +267,7 @@ OptimalConcurrency Calibration::calibrate(
             continue;
         }
 
-        if (qpsAfter > previousCycleQPS * 1.001 || mtWorkload->threadCount() <= 20) {
+        if (qpsAfter > previousCycleQPS * 1.001) {
             std::cerr << "Incrementing thread count from " << mtWorkload->threadCount()
                 << " with current " << statsAfter << std::endl;
             mtWorkload->scaleNonBlockingWorkloadTo(mtWorkload->threadCount() + 1);
@@ -46,9 +280,6 @@ OptimalConcurrency Calibration::calibrate(
             << " and QPS " << previousCycleQPS << " after new cycle QPS stagnated at "
             << previousCycleQPS << std::endl;
 
-        // Stop all the jobs.
-        mtWorkload->scaleNonBlockingWorkloadTo(0);
-
         // Result is the previous iteration.
         return { mtWorkload->threadCount() - 1, previousCycleQPS };
     }
@@ -1,22 +1,73 @@
+#pragma once
+
 #include <chrono>
 #include <functional>
+#include <map>
+#include <string>
 
 #include "benchmarks/continuous_workload.h"
 
 namespace blocking_to_async {
 namespace testing {
 
+struct CalibrationOptions {
+    enum class Method {
+        // Exponential sweep of the thread count followed by a golden-section search.
+        kSearch,
+        // Adds one thread at a time until the QPS stagnates.
+        kLinear,
+    };
+
+    Method method = Method::kSearch;
+    // Length of one QPS sample.
+    std::chrono::milliseconds sampleDuration{ 250 };
+    int minSamples = 3;
+    int maxSamples = 12;
+    // Sampling of a thread count stops when the 95% confidence interval of the mean
+    // QPS is within this fraction of the mean.
+    double relativeConfidence = 0.02;
+    // Upper bound of the sweep, zero means 32 threads per hardware thread.
+    int maxThreads = 0;
+    // Results are cached per CPU model, core count and `Config`. Empty disables the cache.
+    std::string cachePath;
+    // Ignore the cached result and store a new one.
+    bool recalibrate = false;
+
+    // Defaults with the cache in the temp directory, overridden by the
+    // `--calibration=search|linear`, `--calibration_cache=<path>` and `--recalibrate`
+    // flags which are removed from `argv`.
+    static CalibrationOptions fromCommandLine(int* argc, char** argv);
+};
+
 class Calibration {
 public:
+    explicit Calibration(const CalibrationOptions& options = CalibrationOptions());
+
     // Returns the optimal thread count.
     OptimalConcurrency calibrate(
         const Config& config,
         MultithreadedWorkload *mtWorkload);
 
 private:
+    struct Measurement {
+        double qps = 0;
+        // Half width of the 95% confidence interval of `qps`.
+        double halfWidth = 0;
+    };
+
+    OptimalConcurrency _calibrateLinear(MultithreadedWorkload *mtWorkload);
+    OptimalConcurrency _calibrateSearch(MultithreadedWorkload *mtWorkload);
+
+    // Runs `threadCount` non blocking threads until the mean QPS is known with the
+    // configured confidence. Results are memoized.
+    const Measurement& _measure(MultithreadedWorkload *mtWorkload, int threadCount);
+
+    std::string _cacheKey(const Config& config) const;
+
+    const CalibrationOptions _options;
+    std::map<int, Measurement> _measurements;
 };
 
 
 }  // namespace testing
 }  // namespace blocking_to_async
-
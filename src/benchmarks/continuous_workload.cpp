@@ -1,4 +1,7 @@
+#include <bit>
 #include <cassert>
+#include <charconv>
+#include <cstring>
 #include <ctime>
 #include <cstdlib>
 #include <iostream>
@@ -14,6 +17,7 @@ namespace testing {
 
 std::mutex ContinuousWorkload::_mutex;
 std::deque<uint64_t>* ContinuousWorkload::_data;
+MemoryArena* ContinuousWorkload::_arena;
 
 static unsigned getCoreId() {
     unsigned id;
@@ -24,6 +28,15 @@ static unsigned getCoreId() {
 void ContinuousWorkload::init(const Config& config) {
     _config = config;
     std::lock_guard<std::mutex> guard(_mutex);
+    if (_config.sharedData == Config::SharedData::kArena) {
+        if (_arena && _arena->size() >= _config.sharedDataSize &&
+            _arena->options() == _config.arena) {
+            return;
+        }
+        delete _arena;
+        _arena = new MemoryArena(_config.sharedDataSize, _config.arena);
+        return;
+    }
     if (_data && _data->size() >= _config.sharedDataSize) {
         return;
     }
@@ -35,15 +48,74 @@ void ContinuousWorkload::init(const Config& config) {
     }
 }
 
+bool ContinuousWorkload::flagsFromCommandLine(int* argc, char** argv, Config* config) {
+    bool valid = true;
+    int kept = 1;
+    for (int i = 1; i < *argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--shared_data=", 0) == 0) {
+            auto value = arg.substr(strlen("--shared_data="));
+            config->sharedData = Config::SharedData::kArena;
+            if (value == "deque") {
+                config->sharedData = Config::SharedData::kDeque;
+            } else if (value == "small") {
+                config->arena.pages = ArenaOptions::Pages::kSmall;
+            } else if (value == "thp") {
+                config->arena.pages = ArenaOptions::Pages::kTransparentHuge;
+            } else if (value == "hugetlb") {
+                config->arena.pages = ArenaOptions::Pages::kHugeTlb;
+            } else {
+                std::cerr << "Unknown shared data " << value << std::endl;
+                valid = false;
+            }
+        } else if (arg.rfind("--shared_data_fragment=", 0) == 0) {
+            auto value = arg.substr(strlen("--shared_data_fragment="));
+            auto [end, error] = std::from_chars(
+                value.data(), value.data() + value.size(), config->arena.fragmentBytes);
+            if (value.empty() || error != std::errc() || end != value.data() + value.size()) {
+                std::cerr << "Invalid fragment size " << value << std::endl;
+                valid = false;
+            } else if (config->arena.fragmentBytes != 0 &&
+                (config->arena.fragmentBytes < sizeof(uint64_t) ||
+                    !std::has_single_bit(config->arena.fragmentBytes))) {
+                std::cerr << "Fragment size must be a power of two of at least 8 bytes"
+                    << std::endl;
+                valid = false;
+            }
+        } else if (arg.rfind("--shard_lock=", 0) == 0) {
+            auto value = arg.substr(strlen("--shard_lock="));
+            if (!parseLockKind(value, &config->shardLock)) {
+                std::cerr << "Unknown shard lock " << value << std::endl;
+                valid = false;
+            }
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    *argc = kept;
+    return valid;
+}
+
 int ContinuousWorkload::unitOfWork() {
-    assert(!_data->empty());
+    return withLockType(_config.shardLock, [this](auto lockType) {
+        using Lock = typename decltype(lockType)::type;
+        if (_config.sharedData == Config::SharedData::kArena) {
+            return _unitOfWork<Lock>(_arena);
+        }
+        return _unitOfWork<Lock>(_data);
+    });
+}
+
+template <typename Lock, typename Data>
+int ContinuousWorkload::_unitOfWork(Data* data) {
+    assert(data->size() > 0);
     static constexpr int kMemoryIterations = 20;
     static constexpr int kMemoryJump = 10;
     int threadMigrations = 0;
     auto previousCoreId = getCoreId();
     static thread_local std::mt19937 gen;
     std::uniform_int_distribution<std::mt19937::result_type> distrib(
-        0, _data->size() - _config.memoryWorkSizePerIteration * kMemoryJump);
+        0, data->size() - _config.memoryWorkSizePerIteration * kMemoryJump);
 
     for (int memorySegment = 0; memorySegment < kMemoryIterations; ++memorySegment) {
         uint64_t idx1 = distrib(gen);
@@ -51,23 +123,28 @@ int ContinuousWorkload::unitOfWork() {
 
         for (int i = 0; i < _config.memoryWorkSizePerIteration / kMemoryIterations;
             ++i, idx1 += kMemoryJump, idx2 += kMemoryJump) {
-            assert(idx1 < _data->size());
-            assert(idx2 < _data->size());
-            auto& shuffled = (*_data)[idx1];
+            assert(idx1 < data->size());
+            assert(idx2 < data->size());
+            auto& shuffled = (*data)[idx1];
             shuffled ^= shuffled << 7 & MASK_16;
             shuffled ^= shuffled >> 9;
             shuffled ^= shuffled << 8 & MASK_16;
 
             double number = (shuffled & MASK_16) * 3.14;
-            (*_data)[idx2] += *reinterpret_cast<uint64_t*>(&number);
+            (*data)[idx2] += *reinterpret_cast<uint64_t*>(&number);
 
             {
                 // Artificial lock contention to increase the rate of context switches.
                 static constexpr int kShards = 40;
-                static std::array<std::mutex, kShards> mutexes;
+                // Every lock gets its own cache line, the small spin locks would share
+                // lines otherwise.
+                struct alignas(64) PaddedLock {
+                    Lock mutex;
+                };
+                static std::array<PaddedLock, kShards> mutexes;
                 static std::array<int, kShards> counters;
                 auto idx = counters[previousCoreId % kShards] % kShards;
-                std::lock_guard<std::mutex> guard(mutexes[idx]);
+                std::lock_guard<Lock> guard(mutexes[idx].mutex);
                 ++counters[idx];
             }
 
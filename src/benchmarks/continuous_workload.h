@@ -1,7 +1,11 @@
+#pragma once
+
 #include <chrono>
+#include <cstdint>
 #include <deque>
 #include <mutex>
 
+#include "benchmarks/memory_arena.h"
 #include "benchmarks/workload.h"
 
 namespace blocking_to_async {
@@ -14,12 +18,22 @@ public:
     void init(const Config& config) override;
 
     int unitOfWork() override;
+
+    // Removes `--shared_data=deque|small|thp|hugetlb`, `--shared_data_fragment=<bytes>`
+    // and `--shard_lock=mutex|ttas|mcs|futex|adaptive` from the command line and applies
+    // them to `config`. False for an invalid value.
+    static bool flagsFromCommandLine(int* argc, char** argv, Config* config);
+
 private:
+    template <typename Lock, typename Data>
+    int _unitOfWork(Data* data);
+
     // Const after init.
     Config _config;
 
     static std::mutex _mutex;
     static std::deque<uint64_t>* _data;
+    static MemoryArena* _arena;
 };
 
 }  // namespace testing
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+
+#include "benchmarks/thread_pool.h"
+#include "benchmarks/timer_reactor.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+// Coroutine that starts eagerly and frees its own frame when it finishes. The owner
+// is responsible to keep everything the coroutine touches alive until then.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+};
+
+// `co_await ScheduleOn(pool)` continues the coroutine on a thread of the pool.
+class ScheduleOn {
+public:
+    explicit ScheduleOn(ThreadPool& threadPool) : _threadPool(threadPool) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        _threadPool.queueJob([handle] { handle.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    ThreadPool& _threadPool;
+};
+
+// `co_await SleepFor(reactor, pool, duration)` is the async counterpart of a blocking
+// sleep: the coroutine is parked as a reactor timer and resumes on a thread of the pool.
+// Evaluates to the time the timer fired and queued the resumption.
+class SleepFor {
+public:
+    SleepFor(TimerReactor& timerReactor, ThreadPool& threadPool, std::chrono::microseconds duration)
+        : _timerReactor(timerReactor),
+          _threadPool(threadPool),
+          _deadline(TimerReactor::Clock::now() + duration) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        // The awaiter lives in the coroutine frame until the resumption.
+        _timerReactor.schedule(_deadline, [this, handle] {
+            _firedAt = TimerReactor::Clock::now();
+            _threadPool.queueJob([handle] { handle.resume(); });
+        });
+    }
+
+    TimerReactor::Clock::time_point await_resume() const noexcept {
+        return _firedAt;
+    }
+
+private:
+    TimerReactor& _timerReactor;
+    ThreadPool& _threadPool;
+    const TimerReactor::Clock::time_point _deadline;
+    TimerReactor::Clock::time_point _firedAt;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,146 @@
+#include "benchmarks/cpu_topology.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <pthread.h>
+#include <sstream>
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+const std::string kCpuRoot = "/sys/devices/system/cpu";
+
+// Empty string if the file does not exist.
+std::string readLine(const std::string& path) {
+    std::ifstream infile(path);
+    std::string line;
+    std::getline(infile, line);
+    return line;
+}
+
+// Assigns dense ids to distinct keys in order of appearance.
+template <typename Key>
+int denseId(std::map<Key, int>* ids, const Key& key) {
+    auto [it, inserted] = ids->emplace(key, ids->size());
+    return it->second;
+}
+
+}  // namespace
+
+std::vector<int> CpuTopology::parseCpuList(const std::string& cpuList) {
+    std::vector<int> cpus;
+    std::istringstream iss(cpuList);
+    std::string range;
+    while (std::getline(iss, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        auto dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+CpuTopology CpuTopology::read() {
+    CpuTopology topology;
+    std::map<std::pair<int, int>, int> coreIds;
+    std::map<std::string, int> llcIds;
+
+    for (int id : parseCpuList(readLine(kCpuRoot + "/online"))) {
+        Cpu cpu{ id };
+        auto cpuPath = kCpuRoot + "/cpu" + std::to_string(id);
+
+        auto coreId = readLine(cpuPath + "/topology/core_id");
+        auto packageId = readLine(cpuPath + "/topology/physical_package_id");
+        if (!coreId.empty() && !packageId.empty()) {
+            cpu.core = denseId(&coreIds, { std::stoi(packageId), std::stoi(coreId) });
+        }
+
+        // The highest cache level is the last level cache, its sharing list identifies it.
+        int llcLevel = 0;
+        std::string llcSharedCpus;
+        for (int index = 0;; ++index) {
+            auto cachePath = cpuPath + "/cache/index" + std::to_string(index);
+            auto level = readLine(cachePath + "/level");
+            if (level.empty()) {
+                break;
+            }
+            if (std::stoi(level) > llcLevel) {
+                llcLevel = std::stoi(level);
+                llcSharedCpus = readLine(cachePath + "/shared_cpu_list");
+            }
+        }
+        if (!llcSharedCpus.empty()) {
+            cpu.llc = denseId(&llcIds, llcSharedCpus);
+        }
+
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(cpuPath, error)) {
+            auto name = entry.path().filename().string();
+            if (name.rfind("node", 0) == 0 && name.size() > 4 &&
+                std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+                cpu.numaNode = std::stoi(name.substr(4));
+                break;
+            }
+        }
+        topology._cpus.push_back(cpu);
+    }
+
+    if (topology._cpus.empty()) {
+        std::cerr << "Failed to read the CPU topology from " << kCpuRoot << std::endl;
+    }
+    return topology;
+}
+
+std::vector<std::vector<int>> CpuTopology::domains(Level level) const {
+    std::map<int, std::vector<int>> byDomain;
+    for (const auto& cpu : _cpus) {
+        int domain = -1;
+        switch (level) {
+        case Level::kCore:
+            domain = cpu.core;
+            break;
+        case Level::kLlc:
+            domain = cpu.llc;
+            break;
+        case Level::kNumaNode:
+            domain = cpu.numaNode;
+            break;
+        }
+        byDomain[domain].push_back(cpu.id);
+    }
+
+    std::vector<std::vector<int>> result;
+    for (auto& [domain, cpus] : byDomain) {
+        result.push_back(std::move(cpus));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void pinCurrentThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return;
+    }
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &cpuSet);
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (rc != 0) {
+        std::cerr << "Failed to pin thread to " << cpus.size() << " CPUs" << std::endl;
+    }
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace blocking_to_async {
+namespace testing {
+
+// Placement of the CPUs as reported by /sys/devices/system/cpu.
+class CpuTopology {
+public:
+    enum class Level {
+        // Hyperthreads of one physical core.
+        kCore,
+        // CPUs sharing the last level cache.
+        kLlc,
+        kNumaNode,
+    };
+
+    struct Cpu {
+        int id;
+        // Unique within the topology, -1 if the kernel does not report it.
+        int core = -1;
+        int llc = -1;
+        int numaNode = -1;
+    };
+
+    // Reads the topology of the online CPUs. Missing information collapses the
+    // corresponding level into a single domain.
+    static CpuTopology read();
+
+    const std::vector<Cpu>& cpus() const {
+        return _cpus;
+    }
+
+    // CPU ids grouped by the domains of `level`, ordered by the lowest CPU id.
+    std::vector<std::vector<int>> domains(Level level) const;
+
+    // Parses a kernel cpu list like "0-3,8,10-11".
+    static std::vector<int> parseCpuList(const std::string& cpuList);
+
+private:
+    std::vector<Cpu> _cpus;
+};
+
+// Restricts the calling thread to `cpus`, no-op for an empty list.
+void pinCurrentThread(const std::vector<int>& cpus);
+
+}  // namespace testing
+}  // namespace blocking_to_async
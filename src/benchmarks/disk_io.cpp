@@ -0,0 +1,119 @@
+#include "benchmarks/disk_io.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+constexpr size_t kAlignment = 4096;
+
+}  // namespace
+
+DataFile::DataFile(const DiskReadOptions& options) : _options(options) {
+    assert(_options.blockSize > 0 && _options.fileSize >= _options.blockSize);
+    assert(_options.readsPerBlockingCall >= 1);
+    assert(!_options.directIo || _options.blockSize % kAlignment == 0);
+    if (_options.path.empty()) {
+        _options.path =
+            (std::filesystem::temp_directory_path() / "blocking_to_async_data.bin").string();
+    }
+
+    struct stat fileStat;
+    if (stat(_options.path.c_str(), &fileStat) != 0 ||
+        static_cast<size_t>(fileStat.st_size) < _options.fileSize) {
+        std::cerr << "Creating data file " << _options.path << " of " << _options.fileSize
+            << " bytes" << std::endl;
+        int fd = open(_options.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        assert(fd >= 0);
+        // Random content, so that nothing on the way can compress or dedupe the blocks.
+        std::vector<uint64_t> chunk((size_t{1} << 20) / sizeof(uint64_t));
+        std::mt19937_64 gen;
+        for (size_t written = 0; written < _options.fileSize;) {
+            for (auto& word : chunk) {
+                word = gen();
+            }
+            auto size = std::min(chunk.size() * sizeof(uint64_t), _options.fileSize - written);
+            auto rc = write(fd, chunk.data(), size);
+            assert(rc > 0);
+            written += rc;
+        }
+        fsync(fd);
+        close(fd);
+    }
+
+    _fd = open(_options.path.c_str(), O_RDONLY | (_options.directIo ? O_DIRECT : 0));
+    if (_fd < 0 && _options.directIo) {
+        // tmpfs and some other file systems refuse O_DIRECT.
+        std::cerr << "O_DIRECT is not supported for " << _options.path << ": "
+            << strerror(errno) << ", using buffered reads" << std::endl;
+        _options.directIo = false;
+        _fd = open(_options.path.c_str(), O_RDONLY);
+    }
+    assert(_fd >= 0);
+    // The file was just written or read by an earlier run.
+    evictFromPageCache();
+}
+
+DataFile::~DataFile() {
+    if (auto failed = _failedReads.load()) {
+        std::cerr << failed << " reads of " << _options.path << " failed" << std::endl;
+    }
+    close(_fd);
+}
+
+uint64_t DataFile::randomOffset() const {
+    static thread_local std::mt19937_64 gen(std::random_device{}());
+    std::uniform_int_distribution<uint64_t> distrib(
+        0, _options.fileSize / _options.blockSize - 1);
+    return distrib(gen) * _options.blockSize;
+}
+
+DataFile::Buffer DataFile::allocateBuffer() const {
+    auto size = (_options.blockSize + kAlignment - 1) / kAlignment * kAlignment;
+    return Buffer(static_cast<char*>(aligned_alloc(kAlignment, size)));
+}
+
+void DataFile::readRandomBlock() const {
+    static thread_local Buffer buffer;
+    static thread_local size_t bufferSize = 0;
+    if (bufferSize < _options.blockSize) {
+        buffer = allocateBuffer();
+        bufferSize = _options.blockSize;
+    }
+    auto rc = pread(_fd, buffer.get(), _options.blockSize, randomOffset());
+    if (rc < 0) {
+        onReadFailed(errno);
+    }
+}
+
+void DataFile::blockingRead() const {
+    for (int i = 0; i < _options.readsPerBlockingCall; ++i) {
+        readRandomBlock();
+    }
+}
+
+void DataFile::evictFromPageCache() const {
+    if (!_options.directIo) {
+        posix_fadvise(_fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+}
+
+void DataFile::onReadFailed(int error) const {
+    if (_failedReads.fetch_add(1, std::memory_order_relaxed) == 0) {
+        std::cerr << "Read of " << _options.path << " failed: " << strerror(error) << std::endl;
+    }
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+namespace blocking_to_async {
+namespace testing {
+
+struct DiskReadOptions {
+    // Created once and reused by later runs. Empty path means a file in the temp directory.
+    std::string path;
+    size_t fileSize = size_t{1} << 30;
+    // Must be a multiple of 4 KiB with `directIo`.
+    size_t blockSize = 4096;
+    // Bypass the page cache with `O_DIRECT`. Without it the file is evicted from the page
+    // cache when opened, so that reads are not all cache hits.
+    bool directIo = false;
+    // Reads per blocking call, one after the other, on every backend. The blocking time is
+    // whatever the storage takes, not the one computed from the blocking ratio.
+    int readsPerBlockingCall = 1;
+
+    bool operator==(const DiskReadOptions& other) const = default;
+};
+
+// Data file read in random block aligned chunks, the real I/O replacement of the
+// synthetic sleep.
+class DataFile {
+public:
+    struct FreeDeleter {
+        void operator()(char* p) const {
+            free(p);
+        }
+    };
+    using Buffer = std::unique_ptr<char, FreeDeleter>;
+
+    explicit DataFile(const DiskReadOptions& options);
+    ~DataFile();
+
+    const DiskReadOptions& options() const {
+        return _options;
+    }
+
+    int fd() const {
+        return _fd;
+    }
+
+    // Thread safe. Random block aligned offset to read `blockSize` bytes from.
+    uint64_t randomOffset() const;
+
+    // Buffer suitable for a block read, aligned for `O_DIRECT`.
+    Buffer allocateBuffer() const;
+
+    // Blocking `pread` of one random block.
+    void readRandomBlock() const;
+
+    // The blocking call: `readsPerBlockingCall` reads.
+    void blockingRead() const;
+
+    // Drops the file from the page cache, a no-op with `directIo`.
+    void evictFromPageCache() const;
+
+    // Thread safe. Counts a failed read, only the first one is reported.
+    void onReadFailed(int error) const;
+
+private:
+    DiskReadOptions _options;
+    int _fd = -1;
+    mutable std::atomic<uint64_t> _failedReads{0};
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
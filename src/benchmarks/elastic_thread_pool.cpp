@@ -0,0 +1,278 @@
+#include "benchmarks/elastic_thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <optional>
+
+namespace blocking_to_async {
+namespace testing {
+
+ElasticThreadPool::ElasticThreadPool(const ThreadPoolOptions::ElasticOptions& options,
+                                     int dequeueBatch)
+    : _options(options), _dequeueBatch(std::max(1, dequeueBatch)) {}
+
+ElasticThreadPool::~ElasticThreadPool() {
+    stop();
+}
+
+void ElasticThreadPool::start(int concurrency) {
+    assert(concurrency >= 1);
+    _maxThreads = _options.maxThreads > 0 ? _options.maxThreads : concurrency;
+    _minThreads = std::clamp(_options.minThreads, 1, _maxThreads);
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        _shouldTerminate = false;
+        for (int i = 0; i < _minThreads; ++i) {
+            _spawnThread();
+        }
+    }
+    _monitorThread = std::thread([this] { _monitorLoop(); });
+}
+
+bool ElasticThreadPool::isWarm() const {
+    return _startedThreads >= _minThreads;
+}
+
+void ElasticThreadPool::queueJob(Task&& job) {
+    auto priority = JobPriority::kNormal;
+    auto node = _offerNextJob(JobNode::allocate(std::move(job)), &priority);
+    if (!node) {
+        return;
+    }
+    bool shouldNotify = false;
+    bool wakeMonitor = false;
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        _jobs.push(node, priority);
+        shouldNotify = _idleThreads > 0;
+        wakeMonitor = _takeMonitorWakeup();
+    }
+    if (shouldNotify) {
+        _mutexCondition.notify_one();
+    }
+    if (wakeMonitor) {
+        _monitorCondition.notify_one();
+    }
+}
+
+void ElasticThreadPool::queueJobs(std::span<Task> jobs, JobPriority priority) {
+    JobQueue batch;
+    // A job of the other priority displaced from the next job slot.
+    JobNode* displaced = nullptr;
+    auto displacedPriority = priority;
+    for (auto& job : jobs) {
+        auto nodePriority = priority;
+        if (auto node = _offerNextJob(JobNode::allocate(std::move(job)), &nodePriority)) {
+            if (nodePriority == priority) {
+                batch.push(node);
+            } else {
+                displaced = node;
+                displacedPriority = nodePriority;
+            }
+        }
+    }
+    if (batch.empty() && !displaced) {
+        return;
+    }
+    int toWake = 0;
+    bool wakeMonitor = false;
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        toWake = std::min<int>(batch.size() + (displaced ? 1 : 0), _idleThreads);
+        if (displaced) {
+            _jobs.push(displaced, displacedPriority);
+        }
+        _jobs.splice(batch, priority);
+        wakeMonitor = _takeMonitorWakeup();
+    }
+    for (int i = 0; i < toWake; ++i) {
+        _mutexCondition.notify_one();
+    }
+    if (wakeMonitor) {
+        _monitorCondition.notify_one();
+    }
+}
+
+void ElasticThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        if (_shouldTerminate && !_monitorThread.joinable()) {
+            return;
+        }
+        _shouldTerminate = true;
+    }
+    _mutexCondition.notify_all();
+    _monitorCondition.notify_all();
+    if (_monitorThread.joinable()) {
+        _monitorThread.join();
+    }
+    std::map<int, std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        threads.swap(_threads);
+    }
+    for (auto& [threadId, thread] : threads) {
+        thread.join();
+    }
+    _joinRetiredThreads();
+}
+
+int ElasticThreadPool::queueSize() const {
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    return _jobs.size();
+}
+
+int ElasticThreadPool::currentlyRunning() const {
+    return _currentlyRunning;
+}
+
+int ElasticThreadPool::spareCapacity() const {
+    return _maxThreads - _currentlyRunning;
+}
+
+ThreadPool::ThreadChurn ElasticThreadPool::threadChurn() const {
+    return { _spawned.load(), _retired.load() };
+}
+
+int ElasticThreadPool::threadCount() const {
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    return _threads.size();
+}
+
+void ElasticThreadPool::_spawnThread() {
+    int threadId = _nextThreadId++;
+    _threads.emplace(threadId, std::thread([this, threadId] { _threadLoop(threadId); }));
+}
+
+void ElasticThreadPool::_joinRetiredThreads() {
+    std::vector<std::thread> retired;
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        retired.swap(_retiredThreads);
+    }
+    for (auto& thread : retired) {
+        thread.join();
+    }
+}
+
+void ElasticThreadPool::_monitorLoop() {
+    // Poll at a fraction of the threshold so that the busy period is measured with
+    // reasonable precision.
+    auto pollInterval = std::max<std::chrono::microseconds>(
+        _options.spawnAfterBusy / 4, std::chrono::microseconds(10));
+    std::optional<std::chrono::steady_clock::time_point> busySince;
+    // Polling starts when a queued job finds no idle worker and stops at the first poll
+    // that finds one, an idle pool does not wake the monitor up.
+    bool polling = false;
+
+    std::unique_lock<std::mutex> lock(_queueMutex);
+    while (!_shouldTerminate) {
+        bool polled = polling;
+        if (polling) {
+            _monitorCondition.wait_for(lock, pollInterval);
+        } else {
+            _monitorSleeping = true;
+            _monitorCondition.wait(lock, [this] {
+                return !_monitorSleeping || _shouldTerminate || !_retiredThreads.empty();
+            });
+            // Cleared by `_takeMonitorWakeup()`.
+            polling = !_monitorSleeping;
+            _monitorSleeping = false;
+        }
+        if (_shouldTerminate) {
+            break;
+        }
+        auto now = std::chrono::steady_clock::now();
+        bool saturated = !_jobs.empty() && _idleThreads == 0;
+        if (!saturated) {
+            busySince.reset();
+            polling = polling && !polled;
+        } else if (!busySince) {
+            busySince = now;
+        } else if (now - *busySince >= _options.spawnAfterBusy &&
+                   _threads.size() < _maxThreads) {
+            // One new worker per waiting job, the backlog is what the current workers
+            // could not absorb.
+            int toSpawn = std::min<int>(_jobs.size(), _maxThreads - _threads.size());
+            for (int i = 0; i < toSpawn; ++i) {
+                _spawnThread();
+            }
+            _spawned += toSpawn;
+            busySince.reset();
+        }
+        if (!_retiredThreads.empty()) {
+            lock.unlock();
+            _joinRetiredThreads();
+            lock.lock();
+        }
+    }
+}
+
+bool ElasticThreadPool::_takeMonitorWakeup() {
+    // Idle workers that were notified but did not take a job yet still count as idle.
+    if (!_monitorSleeping || _idleThreads >= static_cast<int>(_jobs.size())) {
+        return false;
+    }
+    _monitorSleeping = false;
+    return true;
+}
+
+void ElasticThreadPool::_threadLoop(int threadId) {
+    _onThreadStart();
+    ++_startedThreads;
+    std::vector<JobNode*> batch;
+    batch.reserve(_dequeueBatch);
+    while (true) {
+        bool shouldNotify = false;
+        if (auto next = _takeNextJob()) {
+            batch.push_back(next);
+        } else {
+            std::unique_lock<std::mutex> lock(_queueMutex);
+            ++_idleThreads;
+            bool hasJob = _mutexCondition.wait_for(lock, _options.idleTimeout, [this] {
+                return !_jobs.empty() || _shouldTerminate;
+            });
+            --_idleThreads;
+            if (_shouldTerminate) {
+                _onThreadExit();
+                return;
+            }
+            if (!hasJob) {
+                if (_threads.size() > _minThreads) {
+                    auto self = _threads.find(threadId);
+                    _retiredThreads.push_back(std::move(self->second));
+                    _threads.erase(self);
+                    ++_retired;
+                    // The monitor joins it.
+                    _monitorCondition.notify_one();
+                    _onThreadExit();
+                    return;
+                }
+                continue;
+            }
+            size_t take = std::min<size_t>(
+                _dequeueBatch, (_jobs.size() + _threads.size() - 1) / _threads.size());
+            for (size_t i = 0; i < take; ++i) {
+                batch.push_back(_jobs.pop());
+            }
+            shouldNotify = !_jobs.empty() && _idleThreads > 0;
+        }
+        if (shouldNotify) {
+            _mutexCondition.notify_one();
+        }
+        std::optional<JobBatch::Scope> scope;
+        if (batch.size() > 1) {
+            scope.emplace();
+        }
+        for (auto job : batch) {
+            ++_currentlyRunning;
+            job->task();
+            --_currentlyRunning;
+            JobNode::release(job);
+        }
+        batch.clear();
+    }
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
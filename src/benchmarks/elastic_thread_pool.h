@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "benchmarks/thread_pool.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+// Shared queue thread pool whose size follows the demand. A monitor thread spawns
+// more workers when jobs wait while every worker is busy for longer than
+// `ElasticOptions::spawnAfterBusy`, workers idle for `ElasticOptions::idleTimeout`
+// retire down to the minimum.
+class ElasticThreadPool : public ThreadPool {
+public:
+    ElasticThreadPool(const ThreadPoolOptions::ElasticOptions& options, int dequeueBatch = 1);
+    ~ElasticThreadPool() override;
+
+    // `concurrency` is the maximum size unless `ElasticOptions::maxThreads` is set.
+    void start(int concurrency) override;
+    bool isWarm() const override;
+    void queueJob(Task&& job) override;
+    void queueJobs(std::span<Task> jobs, JobPriority priority) override;
+    void stop() override;
+    int queueSize() const override;
+    int currentlyRunning() const override;
+    // Counts the threads the pool may still spawn.
+    int spareCapacity() const override;
+    ThreadChurn threadChurn() const override;
+
+    int threadCount() const;
+
+private:
+    void _threadLoop(int threadId);
+    void _monitorLoop();
+    // Must be called under `_queueMutex` after queueing jobs. True when queued jobs
+    // outnumber the idle workers while the monitor sleeps, the caller then notifies
+    // `_monitorCondition`.
+    bool _takeMonitorWakeup();
+    // Must be called under `_queueMutex`.
+    void _spawnThread();
+    void _joinRetiredThreads();
+
+    const ThreadPoolOptions::ElasticOptions _options;
+    const int _dequeueBatch;
+    int _minThreads = 0;
+    int _maxThreads = 0;
+
+    bool _shouldTerminate = false;
+    mutable std::mutex _queueMutex;
+    std::condition_variable _mutexCondition;
+    std::condition_variable _monitorCondition;
+    PriorityJobQueue _jobs;
+    // Live workers by id, retired workers move to `_retiredThreads` to be joined.
+    std::map<int, std::thread> _threads;
+    std::vector<std::thread> _retiredThreads;
+    int _nextThreadId = 0;
+    int _idleThreads = 0;
+    // The monitor waits for `_takeMonitorWakeup()` instead of polling.
+    bool _monitorSleeping = false;
+    std::thread _monitorThread;
+
+    std::atomic<int> _currentlyRunning{0};
+    std::atomic<int> _startedThreads{0};
+    std::atomic<int64_t> _spawned{0};
+    std::atomic<int64_t> _retired{0};
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
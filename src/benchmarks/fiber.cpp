@@ -0,0 +1,181 @@
+#include "benchmarks/fiber.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#endif
+
+namespace blocking_to_async {
+namespace testing {
+
+#if defined(__x86_64__)
+
+// Pushes the callee saved registers and the FPU control words on the current stack,
+// saves the stack pointer to `*saveSp`, then pops the same from `loadSp` and returns
+// to whatever called the switch that saved it.
+extern "C" void blockingToAsyncSwitchContext(void** saveSp, void* loadSp);
+// First return address of a new fiber: calls `r13(r12)`.
+extern "C" void blockingToAsyncFiberEntry();
+
+asm(R"(
+    .text
+    .globl blockingToAsyncSwitchContext
+    .type blockingToAsyncSwitchContext, @function
+blockingToAsyncSwitchContext:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $16, %rsp
+    stmxcsr 8(%rsp)
+    fnstcw (%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    fldcw (%rsp)
+    ldmxcsr 8(%rsp)
+    addq $16, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size blockingToAsyncSwitchContext, .-blockingToAsyncSwitchContext
+
+    .globl blockingToAsyncFiberEntry
+    .type blockingToAsyncFiberEntry, @function
+blockingToAsyncFiberEntry:
+    movq %r12, %rdi
+    callq *%r13
+    ud2
+    .size blockingToAsyncFiberEntry, .-blockingToAsyncFiberEntry
+)");
+
+#endif
+
+namespace {
+
+thread_local Fiber* currentFiber = nullptr;
+
+}  // namespace
+
+Fiber::Fiber(Task body, size_t stackSize) : _body(std::move(body)) {
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    stackSize = (stackSize + pageSize - 1) / pageSize * pageSize;
+    _mappingSize = stackSize + pageSize;
+    _mapping = mmap(nullptr, _mappingSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (_mapping == MAP_FAILED) {
+        std::cerr << "Failed to map a fiber stack of " << stackSize << " bytes" << std::endl;
+        std::abort();
+    }
+    // Stacks grow down, an overflow faults on the guard page.
+    mprotect(_mapping, pageSize, PROT_NONE);
+    auto stackBase = static_cast<char*>(_mapping) + pageSize;
+#if defined(__SANITIZE_ADDRESS__)
+    // The mapping may reuse the stack of an exited thread whose shadow is still poisoned.
+    ASAN_UNPOISON_MEMORY_REGION(stackBase, stackSize);
+#endif
+
+#if defined(__x86_64__)
+    // Frame popped by the first switch in: FPU control words, r15 to r12, rbx, rbp and
+    // the return address of the entry. The entry starts with a 16 byte aligned stack.
+    auto top = reinterpret_cast<uint64_t*>(stackBase + stackSize);
+    uint64_t* frame = top - 3;
+    uint32_t mxcsr;
+    uint16_t fpuControl;
+    asm volatile("stmxcsr %0" : "=m"(mxcsr));
+    asm volatile("fnstcw %0" : "=m"(fpuControl));
+    frame[0] = reinterpret_cast<uint64_t>(&blockingToAsyncFiberEntry);
+    frame[-1] = 0;                                     // rbp
+    frame[-2] = 0;                                     // rbx
+    frame[-3] = reinterpret_cast<uint64_t>(this);      // r12
+    frame[-4] = reinterpret_cast<uint64_t>(&_run);     // r13
+    frame[-5] = 0;                                     // r14
+    frame[-6] = 0;                                     // r15
+    frame[-7] = mxcsr;
+    frame[-8] = fpuControl;
+    _fiberSp = frame - 8;
+#else
+    getcontext(&_fiberContext);
+    _fiberContext.uc_stack.ss_sp = stackBase;
+    _fiberContext.uc_stack.ss_size = stackSize;
+    _fiberContext.uc_link = nullptr;
+    // makecontext() passes int arguments only, split the pointer.
+    auto address = reinterpret_cast<uintptr_t>(this);
+    makecontext(&_fiberContext, reinterpret_cast<void (*)()>(+[](uint32_t high, uint32_t low) {
+                    _run(reinterpret_cast<Fiber*>((uintptr_t(high) << 32) | low));
+                }),
+                2, uint32_t(address >> 32), uint32_t(address));
+#endif
+}
+
+Fiber::~Fiber() {
+    munmap(_mapping, _mappingSize);
+}
+
+Fiber* Fiber::current() {
+    return currentFiber;
+}
+
+void Fiber::resume() {
+    assert(!currentFiber && !_finished);
+    currentFiber = this;
+    _switchIn();
+    currentFiber = nullptr;
+    // Another thread may resume the fiber as soon as `onSuspended` runs.
+    Task onSuspended = std::move(_onSuspended);
+    if (onSuspended) {
+        onSuspended();
+    }
+}
+
+void Fiber::suspend(Task onSuspended) {
+    auto fiber = currentFiber;
+    assert(fiber);
+    fiber->_onSuspended = std::move(onSuspended);
+    fiber->_switchOut();
+}
+
+void Fiber::_run(Fiber* fiber) {
+    fiber->_body();
+    fiber->_body = Task();
+    fiber->_finished = true;
+    fiber->_switchOut();
+    // A finished fiber is never resumed.
+    std::abort();
+}
+
+#if defined(__x86_64__)
+
+void Fiber::_switchIn() {
+    blockingToAsyncSwitchContext(&_callerSp, _fiberSp);
+}
+
+void Fiber::_switchOut() {
+    blockingToAsyncSwitchContext(&_fiberSp, _callerSp);
+}
+
+#else
+
+void Fiber::_switchIn() {
+    swapcontext(&_callerContext, &_fiberContext);
+}
+
+void Fiber::_switchOut() {
+    swapcontext(&_fiberContext, &_callerContext);
+}
+
+#endif
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+
+#if !defined(__x86_64__)
+#include <ucontext.h>
+#endif
+
+#include "benchmarks/task.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+// Stackful fiber on its own small mmap'ed stack with a guard page. Any thread may
+// resume a suspended fiber, which then runs on that thread until it suspends again or
+// its body returns. Switches are a handful of register moves on x86-64 and
+// `swapcontext()` elsewhere.
+//
+// Code running on a fiber must not keep the address of a `thread_local` across a
+// suspension: the compiler may cache it in a register while the fiber moves to another
+// thread. Thread locals of other translation units or of non inlined functions are safe.
+class Fiber {
+public:
+    static constexpr size_t kDefaultStackSize = 64 * 1024;
+
+    explicit Fiber(Task body, size_t stackSize = kDefaultStackSize);
+    // The fiber must be finished or never resumed.
+    ~Fiber();
+
+    Fiber(const Fiber&) = delete;
+    Fiber& operator=(const Fiber&) = delete;
+
+    // Runs the fiber on the calling thread until it suspends or finishes. Fibers do not
+    // nest, must not be called from a fiber.
+    void resume();
+
+    // Set once the body returned, the fiber can be destroyed.
+    bool finished() const {
+        return _finished;
+    }
+
+    // Fiber running on the calling thread, null outside of fibers.
+    static Fiber* current();
+
+    // Switches from the current fiber back to the thread that resumed it, which runs
+    // `onSuspended` once the fiber is switched out. `onSuspended` usually registers the
+    // fiber with a reactor, a concurrent `resume()` is safe from then on.
+    static void suspend(Task onSuspended);
+
+private:
+    static void _run(Fiber* fiber);
+
+    // Saves the context of the calling side and switches to the fiber, or back.
+    void _switchIn();
+    void _switchOut();
+
+    Task _body;
+    Task _onSuspended;
+    // Mapping of the stack including the guard page below it.
+    void* _mapping = nullptr;
+    size_t _mappingSize = 0;
+    bool _finished = false;
+#if defined(__x86_64__)
+    // Saved stack pointers, the registers live on the stacks.
+    void* _fiberSp = nullptr;
+    void* _callerSp = nullptr;
+#else
+    ucontext_t _fiberContext;
+    ucontext_t _callerContext;
+#endif
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
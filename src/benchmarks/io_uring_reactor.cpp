@@ -0,0 +1,258 @@
+#include "benchmarks/io_uring_reactor.h"
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "benchmarks/thread_pool.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+unsigned loadAcquire(unsigned* p) {
+    return std::atomic_ref<unsigned>(*p).load(std::memory_order_acquire);
+}
+
+void storeRelease(unsigned* p, unsigned value) {
+    std::atomic_ref<unsigned>(*p).store(value, std::memory_order_release);
+}
+
+// Submitted to every ring by `stop()` to wake up its reaping thread.
+constexpr uint64_t kWakeUpUserData = 0;
+
+}  // namespace
+
+IoUringReactor::Ring::Ring(unsigned entries) {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 2;
+    _fd = ioUringSetup(entries, &params);
+    assert(_fd >= 0);
+
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+        _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+    }
+    _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   _fd, IORING_OFF_SQ_RING);
+    assert(_sqRing != MAP_FAILED);
+    if (singleMmap) {
+        _cqRing = _sqRing;
+    } else {
+        _cqRing = mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       _fd, IORING_OFF_CQ_RING);
+        assert(_cqRing != MAP_FAILED);
+    }
+    _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes = static_cast<io_uring_sqe*>(mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES));
+    assert(_sqes != MAP_FAILED);
+
+    auto sq = static_cast<char*>(_sqRing);
+    _sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    _sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    _sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    _sqEntries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    _sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    auto cq = static_cast<char*>(_cqRing);
+    _cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    _cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    _cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+IoUringReactor::Ring::~Ring() {
+    munmap(_sqes, _sqesSize);
+    if (_cqRing != _sqRing) {
+        munmap(_cqRing, _cqRingSize);
+    }
+    munmap(_sqRing, _sqRingSize);
+    close(_fd);
+}
+
+void IoUringReactor::Ring::submit(const io_uring_sqe& sqe) {
+    std::lock_guard<std::mutex> lock(_submitMutex);
+    // Every entry is submitted right away, so the queue never holds more than one.
+    unsigned tail = *_sqTail;
+    assert(tail - loadAcquire(_sqHead) < _sqEntries);
+    unsigned index = tail & _sqMask;
+    _sqes[index] = sqe;
+    _sqArray[index] = index;
+    storeRelease(_sqTail, tail + 1);
+
+    while (true) {
+        int rc = ioUringEnter(_fd, 1, 0, 0);
+        if (rc >= 0) {
+            break;
+        }
+        // The completion queue overflowed, give the reaping thread time to catch up.
+        assert(errno == EBUSY || errno == EAGAIN || errno == EINTR);
+        std::this_thread::yield();
+    }
+}
+
+void IoUringReactor::Ring::waitForCompletions(std::vector<io_uring_cqe>* completions) {
+    while (true) {
+        unsigned head = *_cqHead;
+        unsigned tail = loadAcquire(_cqTail);
+        if (head != tail) {
+            for (; head != tail; ++head) {
+                completions->push_back(_cqes[head & _cqMask]);
+            }
+            storeRelease(_cqHead, head);
+            return;
+        }
+        int rc = ioUringEnter(_fd, 0, 1, IORING_ENTER_GETEVENTS);
+        assert(rc >= 0 || errno == EINTR || errno == EAGAIN || errno == EBUSY);
+    }
+}
+
+IoUringReactor::~IoUringReactor() {
+    stop();
+}
+
+bool IoUringReactor::isSupported() {
+    io_uring_params params{};
+    int fd = ioUringSetup(1, &params);
+    if (fd < 0) {
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+void IoUringReactor::start(const IoUringOptions& options) {
+    assert(options.rings >= 1);
+    _options = options;
+    _shouldTerminate = false;
+
+    for (int i = 0; i < _options.rings; ++i) {
+        _rings.push_back(std::make_unique<Ring>(_options.ringEntries));
+    }
+    for (auto& ring : _rings) {
+        _reapers.emplace_back([this, ring = ring.get()] { _reaperLoop(ring); });
+    }
+}
+
+void IoUringReactor::stop() {
+    if (_reapers.empty()) {
+        return;
+    }
+    _shouldTerminate = true;
+    while (_pendingOperations.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (auto& ring : _rings) {
+        io_uring_sqe sqe{};
+        sqe.opcode = IORING_OP_NOP;
+        sqe.user_data = kWakeUpUserData;
+        ring->submit(sqe);
+    }
+    for (auto& reaper : _reapers) {
+        reaper.join();
+    }
+    _reapers.clear();
+    _rings.clear();
+}
+
+void IoUringReactor::sleepFor(std::chrono::microseconds duration,
+                              Task continuation) {
+    auto operation = std::make_unique<Operation>();
+    operation->continuation = std::move(continuation);
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration);
+    operation->timeout.tv_sec = seconds.count();
+    operation->timeout.tv_nsec = std::chrono::nanoseconds(duration - seconds).count();
+
+    io_uring_sqe sqe{};
+    sqe.opcode = IORING_OP_TIMEOUT;
+    sqe.fd = -1;
+    sqe.addr = reinterpret_cast<uint64_t>(&operation->timeout);
+    sqe.len = 1;
+    sqe.off = 0;  // Pure timeout, not a completion count.
+    _submit(&sqe, std::move(operation));
+}
+
+void IoUringReactor::readRandomBlock(const DataFile& dataFile,
+                                     Task continuation) {
+    auto operation = std::make_unique<Operation>();
+    operation->continuation = std::move(continuation);
+    operation->buffer = dataFile.allocateBuffer();
+    operation->dataFile = &dataFile;
+    operation->readsLeft = dataFile.options().readsPerBlockingCall;
+
+    auto sqe = _readSqe(*operation);
+    _submit(&sqe, std::move(operation));
+}
+
+io_uring_sqe IoUringReactor::_readSqe(const Operation& operation) {
+    io_uring_sqe sqe{};
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = operation.dataFile->fd();
+    sqe.addr = reinterpret_cast<uint64_t>(operation.buffer.get());
+    sqe.len = operation.dataFile->options().blockSize;
+    sqe.off = operation.dataFile->randomOffset();
+    return sqe;
+}
+
+void IoUringReactor::_submit(io_uring_sqe* sqe, std::unique_ptr<Operation> operation) {
+    assert(!_shouldTerminate.load(std::memory_order_relaxed));
+    static thread_local uint32_t threadSlot = _nextRing.fetch_add(1);
+    ++_pendingOperations;
+    sqe->user_data = reinterpret_cast<uint64_t>(operation.release());
+    _rings[threadSlot % _rings.size()]->submit(*sqe);
+}
+
+void IoUringReactor::_reaperLoop(Ring* ring) {
+    std::vector<io_uring_cqe> completions;
+    bool wokenUp = false;
+    while (!wokenUp) {
+        ring->waitForCompletions(&completions);
+        JobBatch::Scope batch;
+        for (const auto& cqe : completions) {
+            if (cqe.user_data == kWakeUpUserData) {
+                wokenUp = true;
+                continue;
+            }
+            // Timeouts complete with -ETIME, reads with the byte count.
+            std::unique_ptr<Operation> operation(reinterpret_cast<Operation*>(cqe.user_data));
+            if (cqe.res < 0 && operation->dataFile) {
+                operation->dataFile->onReadFailed(-cqe.res);
+            } else if (cqe.res < 0 && cqe.res != -ETIME) {
+                std::cerr << "io_uring operation failed: " << strerror(-cqe.res) << std::endl;
+            }
+            if (operation->readsLeft > 1) {
+                // The next read of the same blocking call, the completions were just
+                // consumed so the completion queue has room for it.
+                --operation->readsLeft;
+                auto sqe = _readSqe(*operation);
+                sqe.user_data = reinterpret_cast<uint64_t>(operation.release());
+                ring->submit(sqe);
+                continue;
+            }
+            operation->continuation();
+            --_pendingOperations;
+        }
+        completions.clear();
+    }
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "benchmarks/disk_io.h"
+#include "benchmarks/task.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+struct IoUringOptions {
+    // Each ring has its own completion reaping thread.
+    int rings = 1;
+    unsigned ringEntries = 4096;
+};
+
+// Blocking calls executed by the kernel through io_uring (raw syscalls, no liburing).
+// Submitters pick a ring by thread, the ring's reaping thread runs the continuation
+// once the completion arrives.
+class IoUringReactor {
+public:
+    ~IoUringReactor();
+
+    // Probes whether the kernel allows creating a ring.
+    static bool isSupported();
+
+    void start(const IoUringOptions& options);
+
+    // Waits for the submitted operations to complete and runs their continuations.
+    void stop();
+
+    // Thread safe. Completes after `duration` with `IORING_OP_TIMEOUT`.
+    void sleepFor(std::chrono::microseconds duration, Task continuation);
+
+    // Thread safe. The blocking call of `DataFile::blockingRead`: `readsPerBlockingCall`
+    // reads of a random block, one after the other.
+    void readRandomBlock(const DataFile& dataFile, Task continuation);
+
+    int pendingOperations() const {
+        return _pendingOperations;
+    }
+
+private:
+    struct Operation {
+        Task continuation;
+        __kernel_timespec timeout{};
+        DataFile::Buffer buffer;
+        const DataFile* dataFile = nullptr;
+        int readsLeft = 0;
+    };
+
+    class Ring {
+    public:
+        explicit Ring(unsigned entries);
+        ~Ring();
+
+        // Thread safe.
+        void submit(const io_uring_sqe& sqe);
+
+        // Reaping thread only. Blocks until at least one completion is available.
+        void waitForCompletions(std::vector<io_uring_cqe>* completions);
+
+    private:
+        int _fd = -1;
+        std::mutex _submitMutex;
+
+        void* _sqRing = nullptr;
+        size_t _sqRingSize = 0;
+        void* _cqRing = nullptr;
+        size_t _cqRingSize = 0;
+        io_uring_sqe* _sqes = nullptr;
+        size_t _sqesSize = 0;
+
+        unsigned* _sqHead;
+        unsigned* _sqTail;
+        unsigned _sqMask;
+        unsigned _sqEntries;
+        unsigned* _sqArray;
+        unsigned* _cqHead;
+        unsigned* _cqTail;
+        unsigned _cqMask;
+        io_uring_cqe* _cqes;
+    };
+
+    static io_uring_sqe _readSqe(const Operation& operation);
+    void _submit(io_uring_sqe* sqe, std::unique_ptr<Operation> operation);
+
+    void _reaperLoop(Ring* ring);
+
+    IoUringOptions _options;
+    std::vector<std::unique_ptr<Ring>> _rings;
+    std::vector<std::thread> _reapers;
+    std::atomic<bool> _shouldTerminate{false};
+    std::atomic<int> _pendingOperations{0};
+    std::atomic<uint32_t> _nextRing{0};
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,99 @@
+#include "benchmarks/latency_histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+namespace blocking_to_async {
+namespace testing {
+
+int LatencyHistogram::_bucketIndex(uint64_t value) {
+    value = std::min<uint64_t>(value, (uint64_t{ 1 } << kMaxValueBits) - 1);
+    int highestBit = std::bit_width(value) - 1;
+    if (highestBit < kSubBucketBits) {
+        // Values below the sub-bucket count are exact.
+        return value;
+    }
+    int shift = highestBit - kSubBucketBits;
+    int subBucket = (value >> shift) - (uint64_t{ 1 } << kSubBucketBits);
+    return ((shift + 1) << kSubBucketBits) + subBucket;
+}
+
+uint64_t LatencyHistogram::_bucketHighestValue(int index) {
+    constexpr int kSubBuckets = 1 << kSubBucketBits;
+    if (index < kSubBuckets) {
+        return index;
+    }
+    int shift = index / kSubBuckets - 1;
+    uint64_t lowest = uint64_t(kSubBuckets + index % kSubBuckets) << shift;
+    return lowest + (uint64_t{ 1 } << shift) - 1;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency) {
+    if (_counts.empty()) {
+        _counts.resize(kBucketCount);
+    }
+    ++_counts[_bucketIndex(std::max<int64_t>(latency.count(), 0))];
+    ++_count;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other._count == 0) {
+        return;
+    }
+    if (_counts.empty()) {
+        _counts.resize(kBucketCount);
+    }
+    for (int i = 0; i < kBucketCount; ++i) {
+        _counts[i] += other._counts[i];
+    }
+    _count += other._count;
+}
+
+void LatencyHistogram::reset() {
+    _counts.clear();
+    _count = 0;
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double percentile) const {
+    if (_count == 0) {
+        return std::chrono::nanoseconds{ 0 };
+    }
+    assert(percentile >= 0 && percentile <= 100);
+    auto rank = std::max<uint64_t>(1, std::ceil(percentile / 100 * _count));
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += _counts[i];
+        if (seen >= rank) {
+            return std::chrono::nanoseconds(_bucketHighestValue(i));
+        }
+    }
+    return std::chrono::nanoseconds(_bucketHighestValue(kBucketCount - 1));
+}
+
+void RequestLatencies::merge(const RequestLatencies& other) {
+    computeQueueWait.merge(other.computeQueueWait);
+    compute.merge(other.compute);
+    blockingQueueWait.merge(other.blockingQueueWait);
+    block.merge(other.block);
+    continuationQueueWait.merge(other.continuationQueueWait);
+    endToEnd.merge(other.endToEnd);
+}
+
+void RequestLatencies::reset() {
+    *this = RequestLatencies();
+}
+
+void RequestLatencies::forEachStage(
+    const std::function<void(const std::string& name, const LatencyHistogram&)>& visitor) const {
+    visitor("queue", computeQueueWait);
+    visitor("compute", compute);
+    visitor("blockQueue", blockingQueueWait);
+    visitor("block", block);
+    visitor("contQueue", continuationQueueWait);
+    visitor("e2e", endToEnd);
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace blocking_to_async {
+namespace testing {
+
+// HDR style histogram of nanosecond latencies: every power of two range is split into
+// 32 linear sub-buckets, which keeps the relative error of a percentile under 3.2%.
+// Latencies above ~68 seconds are counted in the last bucket.
+class LatencyHistogram {
+public:
+    void record(std::chrono::nanoseconds latency);
+
+    void merge(const LatencyHistogram& other);
+
+    void reset();
+
+    uint64_t count() const {
+        return _count;
+    }
+
+    // Highest latency of the bucket holding the `percentile` (0 to 100) sample, zero
+    // for an empty histogram.
+    std::chrono::nanoseconds percentile(double percentile) const;
+
+private:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr int kMaxValueBits = 36;
+    static constexpr int kBucketCount = (kMaxValueBits - kSubBucketBits + 1) << kSubBucketBits;
+
+    static int _bucketIndex(uint64_t value);
+    static uint64_t _bucketHighestValue(int index);
+
+    // Allocated by the first sample, most workloads record only some of the stages.
+    std::vector<uint64_t> _counts;
+    uint64_t _count = 0;
+};
+
+// Latency breakdown of the requests of a workload. Stages that do not exist in a
+// workload, like the queue waits of a thread per request, stay empty.
+struct RequestLatencies {
+    // From queueing a request into the compute pool until a thread picks it up.
+    LatencyHistogram computeQueueWait;
+    LatencyHistogram compute;
+    // From queueing the blocking call into the blocking calls pool until it starts.
+    LatencyHistogram blockingQueueWait;
+    // Blocking call, or time until the completion of an async backend.
+    LatencyHistogram block;
+    // From queueing the continuation after the blocking call until a thread picks it up.
+    LatencyHistogram continuationQueueWait;
+    LatencyHistogram endToEnd;
+
+    void merge(const RequestLatencies& other);
+
+    void reset();
+
+    // Visits the stages with short names suitable for benchmark counters.
+    void forEachStage(
+        const std::function<void(const std::string& name, const LatencyHistogram&)>& visitor) const;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,114 @@
+#include "benchmarks/locks.h"
+
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+struct LockKindName {
+    LockKind kind;
+    const char* name;
+};
+
+constexpr LockKindName kLockKindNames[] = {
+    { LockKind::kMutex, "mutex" },
+    { LockKind::kTtasSpin, "ttas" },
+    { LockKind::kMcs, "mcs" },
+    { LockKind::kFutex, "futex" },
+    { LockKind::kSpinThenPark, "adaptive" },
+};
+
+long futex(std::atomic<uint32_t>* address, int op, uint32_t value) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(address), op | FUTEX_PRIVATE_FLAG,
+        value, nullptr, nullptr, 0);
+}
+
+}  // namespace
+
+bool parseLockKind(const std::string& name, LockKind* kind) {
+    for (const auto& entry : kLockKindNames) {
+        if (name == entry.name) {
+            *kind = entry.kind;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* lockKindName(LockKind kind) {
+    for (const auto& entry : kLockKindNames) {
+        if (entry.kind == kind) {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+thread_local McsLock::HeldNodes McsLock::_heldNodes;
+
+void McsLock::lock() {
+    assert(_heldNodes.count < kMaxHeldLocks);
+    Node* node = &_heldNodes.nodes[_heldNodes.count++];
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->waiting.store(true, std::memory_order_relaxed);
+    Node* predecessor = _tail.exchange(node, std::memory_order_acq_rel);
+    if (predecessor) {
+        predecessor->next.store(node, std::memory_order_release);
+        while (node->waiting.load(std::memory_order_acquire)) {
+            _mm_pause();
+        }
+    }
+    _ownerNode = node;
+}
+
+void McsLock::unlock() {
+    Node* node = _ownerNode;
+    assert(node == &_heldNodes.nodes[_heldNodes.count - 1]);
+    Node* successor = node->next.load(std::memory_order_acquire);
+    if (!successor) {
+        Node* expected = node;
+        if (_tail.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+            --_heldNodes.count;
+            return;
+        }
+        // A waiter swapped the tail but did not link itself yet.
+        while (!(successor = node->next.load(std::memory_order_acquire))) {
+            _mm_pause();
+        }
+    }
+    successor->waiting.store(false, std::memory_order_release);
+    --_heldNodes.count;
+}
+
+void FutexLock::_lockContended(uint32_t state) {
+    if (state != kContended) {
+        state = _state.exchange(kContended, std::memory_order_acquire);
+    }
+    while (state != kUnlocked) {
+        futex(&_state, FUTEX_WAIT, kContended);
+        state = _state.exchange(kContended, std::memory_order_acquire);
+    }
+}
+
+void FutexLock::_wakeOne() {
+    futex(&_state, FUTEX_WAKE, 1);
+}
+
+void Parker::park() {
+    while (_permit.exchange(0, std::memory_order_acquire) == 0) {
+        futex(&_permit, FUTEX_WAIT, 0);
+    }
+}
+
+void Parker::unpark() {
+    _permit.store(1, std::memory_order_release);
+    futex(&_permit, FUTEX_WAKE, 1);
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <immintrin.h>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+namespace blocking_to_async {
+namespace testing {
+
+// Lock implementations with the `std::mutex` interface for the contended critical
+// sections of the workloads.
+enum class LockKind {
+    kMutex,
+    // Test and test-and-set spinlock with exponential backoff.
+    kTtasSpin,
+    // MCS queue lock, every waiter spins on its own cache line.
+    kMcs,
+    // Three state futex lock, waiters sleep in the kernel right away.
+    kFutex,
+    // Spins for an adaptive number of attempts before sleeping on a futex.
+    kSpinThenPark,
+};
+
+// Parses mutex|ttas|mcs|futex|adaptive, false for anything else.
+bool parseLockKind(const std::string& name, LockKind* kind);
+
+const char* lockKindName(LockKind kind);
+
+class TtasSpinLock {
+public:
+    void lock() {
+        int backoff = 1;
+        while (true) {
+            if (!_locked.load(std::memory_order_relaxed) &&
+                !_locked.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+            for (int i = 0; i < backoff; ++i) {
+                _mm_pause();
+            }
+            backoff = std::min(backoff * 2, kMaxBackoff);
+        }
+    }
+
+    bool try_lock() {
+        return !_locked.load(std::memory_order_relaxed) &&
+            !_locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() {
+        _locked.store(false, std::memory_order_release);
+    }
+
+private:
+    static constexpr int kMaxBackoff = 1024;
+
+    std::atomic<bool> _locked{ false };
+};
+
+// The queue nodes are thread local, a thread may hold up to `kMaxHeldLocks` MCS locks
+// and must release them in reverse order.
+class McsLock {
+public:
+    void lock();
+
+    void unlock();
+
+private:
+    struct alignas(64) Node {
+        std::atomic<Node*> next{ nullptr };
+        std::atomic<bool> waiting{ false };
+    };
+
+    static constexpr int kMaxHeldLocks = 4;
+
+    struct HeldNodes {
+        Node nodes[kMaxHeldLocks];
+        int count = 0;
+    };
+
+    static thread_local HeldNodes _heldNodes;
+
+    std::atomic<Node*> _tail{ nullptr };
+    // Node of the current owner, only accessed by the owner.
+    Node* _ownerNode = nullptr;
+};
+
+class FutexLock {
+public:
+    void lock() {
+        uint32_t state = kUnlocked;
+        if (_state.compare_exchange_strong(state, kLocked, std::memory_order_acquire)) {
+            return;
+        }
+        _lockContended(state);
+    }
+
+    void unlock() {
+        if (_state.exchange(kUnlocked, std::memory_order_release) == kContended) {
+            _wakeOne();
+        }
+    }
+
+protected:
+    static constexpr uint32_t kUnlocked = 0;
+    static constexpr uint32_t kLocked = 1;
+    // Locked and there may be sleeping waiters.
+    static constexpr uint32_t kContended = 2;
+
+    // Slow path of Drepper's "Futexes Are Tricky" mutex, `state` is the last seen value.
+    void _lockContended(uint32_t state);
+
+    void _wakeOne();
+
+    std::atomic<uint32_t> _state{ kUnlocked };
+};
+
+// Single permit of one thread that sleeps on a futex until another thread grants it,
+// without spinning first.
+class Parker {
+public:
+    // Returns once a permit was granted since the previous `park()`, consumes it.
+    void park();
+    void unpark();
+
+private:
+    std::atomic<uint32_t> _permit{ 0 };
+};
+
+// Like the glibc adaptive mutex: the spin budget follows the average number of spins
+// that were needed to get the lock recently.
+class SpinThenParkLock : public FutexLock {
+public:
+    void lock() {
+        uint32_t state = kUnlocked;
+        if (_state.compare_exchange_strong(state, kLocked, std::memory_order_acquire)) {
+            return;
+        }
+        int maxSpins = std::min(kMaxSpins, _averageSpins.load(std::memory_order_relaxed) * 2 + 10);
+        for (int spins = 0; spins < maxSpins; ++spins) {
+            _mm_pause();
+            state = _state.load(std::memory_order_relaxed);
+            if (state == kUnlocked &&
+                _state.compare_exchange_weak(state, kLocked, std::memory_order_acquire)) {
+                _updateAverage(spins);
+                return;
+            }
+        }
+        _updateAverage(maxSpins);
+        _lockContended(state);
+    }
+
+private:
+    static constexpr int kMaxSpins = 200;
+
+    void _updateAverage(int spins) {
+        int average = _averageSpins.load(std::memory_order_relaxed);
+        _averageSpins.store(average + (spins - average) / 8, std::memory_order_relaxed);
+    }
+
+    std::atomic<int> _averageSpins{ 0 };
+};
+
+// Calls `f(std::type_identity<Lock>())` with the lock type of `kind`.
+template <typename F>
+decltype(auto) withLockType(LockKind kind, F&& f) {
+    switch (kind) {
+    case LockKind::kTtasSpin:
+        return f(std::type_identity<TtasSpinLock>());
+    case LockKind::kMcs:
+        return f(std::type_identity<McsLock>());
+    case LockKind::kFutex:
+        return f(std::type_identity<FutexLock>());
+    case LockKind::kSpinThenPark:
+        return f(std::type_identity<SpinThenParkLock>());
+    case LockKind::kMutex:
+        break;
+    }
+    return f(std::type_identity<std::mutex>());
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,439 @@
+#include "benchmarks/loopback_server.h"
+
+#include <arpa/inet.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+// Connection threads do not need the default 8 MiB of stack.
+constexpr size_t kConnectionThreadStackSize = 256 * 1024;
+
+// Client sockets bind to a different 127.0.0.x source address for every this many
+// connections, one source address runs out of ephemeral ports well below 50k.
+constexpr int kConnectionsPerSourceAddress = 20000;
+
+// Reactor epoll tags, anything else is a `Connection*`.
+constexpr uint64_t kListenTag = 0;
+constexpr uint64_t kEventTag = 1;
+
+void setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    int rc = fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    assert(rc == 0);
+}
+
+void setNoDelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// Blocking write of the whole buffer, also for non blocking sockets.
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        auto written = send(fd, data, size, MSG_NOSIGNAL);
+        if (written > 0) {
+            data += written;
+            size -= written;
+        } else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd pfd{ fd, POLLOUT, 0 };
+            poll(&pfd, 1, -1);
+        } else if (written < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void wakeUp(int eventFd) {
+    uint64_t one = 1;
+    auto written = write(eventFd, &one, sizeof(one));
+    assert(written == sizeof(one));
+}
+
+}  // namespace
+
+void raiseFileDescriptorLimit() {
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+}
+
+LoopbackServer::LoopbackServer(const LoopbackServerOptions& options,
+                               std::unique_ptr<Workload> workload)
+    : _options(options),
+      _workload(std::move(workload)) {
+    assert(_workload);
+    assert(_options.iterationsPerRequest >= 1);
+}
+
+LoopbackServer::~LoopbackServer() {
+    stop();
+}
+
+void LoopbackServer::start() {
+    _shouldTerminate = false;
+    _listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(_listenFd >= 0);
+    int one = 1;
+    setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    int rc = bind(_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    assert(rc == 0);
+    rc = listen(_listenFd, SOMAXCONN);
+    assert(rc == 0);
+    socklen_t length = sizeof(address);
+    getsockname(_listenFd, reinterpret_cast<sockaddr*>(&address), &length);
+    _port = ntohs(address.sin_port);
+
+    _eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert(_eventFd >= 0);
+
+    switch (_options.model) {
+    case LoopbackServerOptions::Model::kThreadPerConnection:
+        _acceptThread = std::thread([this] { _acceptLoop(); });
+        break;
+    case LoopbackServerOptions::Model::kPooled: {
+        _computePool = ThreadPool::create(_options.computePool);
+        _blockingPool = ThreadPool::create(_options.blockingPool);
+        _computePool->start(_options.computeThreads);
+        _blockingPool->start(_options.blockingThreads > 0
+                                 ? _options.blockingThreads
+                                 : std::min(_options.computeThreads * 20, 800));
+
+        setNonBlocking(_listenFd);
+        _epollFd = epoll_create1(EPOLL_CLOEXEC);
+        assert(_epollFd >= 0);
+        for (auto [fd, tag] : { std::pair{ _listenFd, kListenTag },
+                                std::pair{ _eventFd, kEventTag } }) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = tag;
+            rc = epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event);
+            assert(rc == 0);
+        }
+        _reactorThread = std::thread([this] { _reactorLoop(); });
+        break;
+    }
+    }
+}
+
+void LoopbackServer::stop() {
+    if (_listenFd < 0) {
+        return;
+    }
+    _shouldTerminate = true;
+    wakeUp(_eventFd);
+
+    if (_acceptThread.joinable()) {
+        _acceptThread.join();
+        // Unblocks the connection threads waiting for a request.
+        for (int fd : _connectionFds) {
+            shutdown(fd, SHUT_RDWR);
+        }
+        for (auto thread : _connectionThreads) {
+            pthread_join(thread, nullptr);
+        }
+        for (int fd : _connectionFds) {
+            close(fd);
+        }
+        _connectionThreads.clear();
+        _connectionFds.clear();
+    }
+
+    if (_reactorThread.joinable()) {
+        _reactorThread.join();
+        // Compute jobs queue blocking jobs, stop in that order.
+        _computePool->stop();
+        _blockingPool->stop();
+        for (auto& connection : _connections) {
+            if (connection->fd >= 0) {
+                close(connection->fd);
+            }
+        }
+        _connections.clear();
+        close(_epollFd);
+        _epollFd = -1;
+    }
+
+    close(_eventFd);
+    close(_listenFd);
+    _eventFd = _listenFd = -1;
+}
+
+std::chrono::microseconds LoopbackServer::_doWork() {
+    auto start = std::chrono::high_resolution_clock::now();
+    int threadMigrations = 0;
+    for (int i = 0; i < _options.iterationsPerRequest; ++i) {
+        threadMigrations += _workload->unitOfWork();
+    }
+    _threadMigrations.fetch_add(threadMigrations, std::memory_order_relaxed);
+    return timeToBlock(std::chrono::high_resolution_clock::now() - start,
+                       _options.ratioOfTimeToBlock);
+}
+
+void LoopbackServer::_acceptLoop() {
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, kConnectionThreadStackSize);
+
+    while (true) {
+        pollfd fds[2] = { { _listenFd, POLLIN, 0 }, { _eventFd, POLLIN, 0 } };
+        poll(fds, 2, -1);
+        if (_shouldTerminate) {
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+        int fd = accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        setNoDelay(fd);
+
+        struct Arguments {
+            LoopbackServer* server;
+            int fd;
+        };
+        pthread_t thread;
+        int rc = pthread_create(
+            &thread, &attributes,
+            [](void* arg) -> void* {
+                std::unique_ptr<Arguments> arguments(static_cast<Arguments*>(arg));
+                arguments->server->_connectionLoop(arguments->fd);
+                return nullptr;
+            },
+            new Arguments{ this, fd });
+        if (rc != 0) {
+            std::cerr << "Failed to create a connection thread: " << strerror(rc) << std::endl;
+            close(fd);
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(_connectionsMutex);
+        _connectionThreads.push_back(thread);
+        _connectionFds.push_back(fd);
+    }
+    pthread_attr_destroy(&attributes);
+}
+
+void LoopbackServer::_connectionLoop(int fd) {
+    char buffer[kLoopbackMessageSize];
+    while (!_shouldTerminate.load(std::memory_order_relaxed)) {
+        auto received = recv(fd, buffer, sizeof(buffer), MSG_WAITALL);
+        if (received != sizeof(buffer)) {
+            return;  // Closed by the client or shut down by `stop()`.
+        }
+        std::this_thread::sleep_for(_doWork());
+        if (!writeAll(fd, buffer, sizeof(buffer))) {
+            return;
+        }
+        _requests.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void LoopbackServer::_reactorLoop() {
+    std::vector<epoll_event> events(256);
+    while (!_shouldTerminate.load(std::memory_order_relaxed)) {
+        int count = epoll_wait(_epollFd, events.data(), events.size(), -1);
+        for (int i = 0; i < count; ++i) {
+            auto tag = events[i].data.u64;
+            if (tag == kEventTag) {
+                continue;
+            }
+            if (tag == kListenTag) {
+                while (true) {
+                    int fd = accept4(_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (fd < 0) {
+                        break;
+                    }
+                    setNoDelay(fd);
+                    auto connection = std::make_unique<Connection>();
+                    connection->fd = fd;
+                    epoll_event event{};
+                    event.events = EPOLLIN | EPOLLONESHOT;
+                    event.data.ptr = connection.get();
+                    int rc = epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event);
+                    assert(rc == 0);
+                    _connections.push_back(std::move(connection));
+                }
+                continue;
+            }
+
+            // One shot: the connection is not armed again until the response is sent.
+            auto connection = static_cast<Connection*>(events[i].data.ptr);
+            auto received = recv(connection->fd,
+                                 connection->buffer + connection->received,
+                                 kLoopbackMessageSize - connection->received, 0);
+            if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR)) {
+                close(connection->fd);
+                connection->fd = -1;
+                continue;
+            }
+            if (received > 0) {
+                connection->received += received;
+            }
+            if (connection->received == kLoopbackMessageSize) {
+                _onRequest(connection);
+            } else {
+                epoll_event event{};
+                event.events = EPOLLIN | EPOLLONESHOT;
+                event.data.ptr = connection;
+                epoll_ctl(_epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+            }
+        }
+    }
+}
+
+void LoopbackServer::_onRequest(Connection* connection) {
+    _computePool->queueJob([this, connection] {
+        auto blockFor = _doWork();
+        _blockingPool->queueJob([this, connection, blockFor] {
+            std::this_thread::sleep_for(blockFor);
+            _sendResponse(connection);
+        });
+    });
+}
+
+void LoopbackServer::_sendResponse(Connection* connection) {
+    connection->received = 0;
+    if (!writeAll(connection->fd, connection->buffer, kLoopbackMessageSize)) {
+        return;
+    }
+    _requests.fetch_add(1, std::memory_order_relaxed);
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = connection;
+    epoll_ctl(_epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+LoopbackClients::LoopbackClients(int port, int connections, int threads)
+    : _port(port),
+      _connections(connections) {
+    assert(connections >= 1 && threads >= 1);
+    for (int i = 0; i < std::min(threads, connections); ++i) {
+        _threads.push_back(std::make_unique<ClientThread>());
+    }
+}
+
+LoopbackClients::~LoopbackClients() {
+    stop();
+}
+
+void LoopbackClients::start() {
+    _shouldTerminate = false;
+    // Connect everything up front so that no request waits for slow connects.
+    for (int i = 0; i < _connections; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        assert(fd >= 0);
+        sockaddr_in source{};
+        source.sin_family = AF_INET;
+        source.sin_addr.s_addr = htonl(INADDR_LOOPBACK + 1 + i / kConnectionsPerSourceAddress);
+        int rc = bind(fd, reinterpret_cast<sockaddr*>(&source), sizeof(source));
+        assert(rc == 0);
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(_port);
+        rc = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        if (rc != 0) {
+            std::cerr << "Connection " << i << " failed: " << strerror(errno) << std::endl;
+            close(fd);
+            continue;
+        }
+        setNoDelay(fd);
+        setNonBlocking(fd);
+        _threads[i % _threads.size()]->fds.push_back(fd);
+    }
+    for (auto& clientThread : _threads) {
+        clientThread->thread = std::thread([this, t = clientThread.get()] { _threadLoop(t); });
+    }
+}
+
+void LoopbackClients::stop() {
+    _shouldTerminate = true;
+    for (auto& clientThread : _threads) {
+        if (clientThread->thread.joinable()) {
+            clientThread->thread.join();
+        }
+        for (int fd : clientThread->fds) {
+            close(fd);
+        }
+        clientThread->fds.clear();
+    }
+}
+
+uint64_t LoopbackClients::responses() const {
+    uint64_t total = 0;
+    for (const auto& clientThread : _threads) {
+        total += clientThread->responses.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void LoopbackClients::_threadLoop(ClientThread* clientThread) {
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    assert(epollFd >= 0);
+    const auto& fds = clientThread->fds;
+    std::vector<size_t> received(fds.size(), 0);
+    char request[kLoopbackMessageSize] = {};
+
+    for (size_t i = 0; i < fds.size(); ++i) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = i;
+        int rc = epoll_ctl(epollFd, EPOLL_CTL_ADD, fds[i], &event);
+        assert(rc == 0);
+        writeAll(fds[i], request, sizeof(request));
+    }
+
+    std::vector<epoll_event> events(256);
+    char buffer[kLoopbackMessageSize];
+    while (!_shouldTerminate.load(std::memory_order_relaxed)) {
+        int count = epoll_wait(epollFd, events.data(), events.size(), 100);
+        for (int i = 0; i < count; ++i) {
+            auto index = events[i].data.u64;
+            auto bytes = recv(fds[index], buffer, kLoopbackMessageSize - received[index], 0);
+            if (bytes <= 0) {
+                if (bytes == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, fds[index], nullptr);
+                }
+                continue;
+            }
+            received[index] += bytes;
+            if (received[index] < kLoopbackMessageSize) {
+                continue;
+            }
+            received[index] = 0;
+            clientThread->responses.fetch_add(1, std::memory_order_relaxed);
+            writeAll(fds[index], request, sizeof(request));
+        }
+    }
+    close(epollFd);
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "benchmarks/thread_pool.h"
+#include "benchmarks/workload.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+// Every request and response is a fixed size message.
+constexpr size_t kLoopbackMessageSize = 64;
+
+struct LoopbackServerOptions {
+    enum class Model {
+        // One thread per accepted connection that reads a request, does the work, blocks
+        // and writes the response, like `ThreadPartiallyBlockedWorkload`.
+        kThreadPerConnection,
+        // Connections are multiplexed by an epoll thread, the work runs on the compute
+        // pool and the blocking part on the blocking pool, like `ThreadPoolWorkload`.
+        kPooled,
+    };
+
+    Model model = Model::kThreadPerConnection;
+    double ratioOfTimeToBlock = 0.8;
+    int iterationsPerRequest = 1;
+
+    // Only used by the `kPooled` model, zero blocking threads picks the same size as
+    // the pooled workload: `min(computeThreads * 20, 800)`.
+    int computeThreads = 16;
+    int blockingThreads = 0;
+    ThreadPoolOptions computePool;
+    ThreadPoolOptions blockingPool;
+};
+
+// Server listening on an ephemeral 127.0.0.1 port.
+class LoopbackServer {
+public:
+    LoopbackServer(const LoopbackServerOptions& options, std::unique_ptr<Workload> workload);
+    ~LoopbackServer();
+
+    void start();
+    void stop();
+
+    int port() const {
+        return _port;
+    }
+
+    uint64_t requests() const {
+        return _requests.load(std::memory_order_relaxed);
+    }
+
+    uint64_t threadMigrations() const {
+        return _threadMigrations.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Connection {
+        int fd;
+        size_t received = 0;
+        char buffer[kLoopbackMessageSize];
+    };
+
+    // Runs the units of work of one request and returns how long to block.
+    std::chrono::microseconds _doWork();
+
+    void _acceptLoop();
+    void _connectionLoop(int fd);
+
+    void _reactorLoop();
+    // Pooled model: the request of `connection` was received completely.
+    void _onRequest(Connection* connection);
+    void _sendResponse(Connection* connection);
+
+    const LoopbackServerOptions _options;
+    const std::unique_ptr<Workload> _workload;
+
+    int _listenFd = -1;
+    int _port = 0;
+    // Wakes up the accept loop or reactor on `stop()`.
+    int _eventFd = -1;
+    std::atomic<bool> _shouldTerminate{false};
+
+    std::atomic<uint64_t> _requests{0};
+    std::atomic<uint64_t> _threadMigrations{0};
+
+    // Thread per connection model.
+    std::thread _acceptThread;
+    std::mutex _connectionsMutex;
+    std::vector<pthread_t> _connectionThreads;
+    std::vector<int> _connectionFds;
+
+    // Pooled model.
+    int _epollFd = -1;
+    std::thread _reactorThread;
+    std::vector<std::unique_ptr<Connection>> _connections;
+    std::unique_ptr<ThreadPool> _computePool;
+    std::unique_ptr<ThreadPool> _blockingPool;
+};
+
+// Closed loop clients: every connection sends the next request as soon as the response
+// to the previous one arrives. Connections are spread over a few epoll driven threads.
+class LoopbackClients {
+public:
+    LoopbackClients(int port, int connections, int threads);
+    ~LoopbackClients();
+
+    void start();
+    void stop();
+
+    uint64_t responses() const;
+
+private:
+    struct alignas(64) ClientThread {
+        std::thread thread;
+        std::vector<int> fds;
+        std::atomic<uint64_t> responses{0};
+    };
+
+    void _threadLoop(ClientThread* clientThread);
+
+    const int _port;
+    const int _connections;
+    std::vector<std::unique_ptr<ClientThread>> _threads;
+    std::atomic<bool> _shouldTerminate{false};
+};
+
+// Raises the open file limit to the hard limit, each loopback connection uses two.
+void raiseFileDescriptorLimit();
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+#include <ostream>
+
+#include "benchmarks/continuous_workload.h"
+#include "benchmarks/loopback_server.h"
+#include "benchmarks/workload_registry.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+static Config config;
+
+namespace {
+
+void loopbackCustomArguments(benchmark::internal::Benchmark* b) {
+    std::vector<int> models{
+        static_cast<int>(LoopbackServerOptions::Model::kThreadPerConnection),
+        static_cast<int>(LoopbackServerOptions::Model::kPooled),
+    };
+    std::vector<int> connections{
+        1000, 5000, 10000, 20000, 50000
+    };
+
+    for (int model : models) {
+        for (int connectionCount : connections) {
+            b->Args({model, connectionCount});
+        }
+    }
+    b->Iterations(2000);
+}
+
+// Arguments: server model and count of client connections. Requests are 80% blocking
+// with one unit of work, the pooled model runs a compute thread per core.
+void BM_loopbackServer(benchmark::State& state) {
+    auto mainThreadWorkload = WorkloadRegistry::instance().create(config);
+
+    LoopbackServerOptions options;
+    options.model = static_cast<LoopbackServerOptions::Model>(state.range(0));
+    options.ratioOfTimeToBlock = 0.8;
+    options.iterationsPerRequest = 1;
+    options.computeThreads = std::thread::hardware_concurrency();
+
+    LoopbackServer server(options, WorkloadRegistry::instance().create(config));
+    server.start();
+    LoopbackClients clients(server.port(), state.range(1), 4);
+    clients.start();
+    // Let all connections reach the steady state.
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto responsesBefore = clients.responses();
+    auto migrationsBefore = server.threadMigrations();
+    for (auto _ : state) {
+        mainThreadWorkload->unitOfWork();
+    }
+    auto seconds = std::chrono::duration<double>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    auto responses = clients.responses() - responsesBefore;
+    auto migrations = server.threadMigrations() - migrationsBefore;
+
+    clients.stop();
+    server.stop();
+    std::cerr << "responses " << responses << " in " << seconds << " s" << std::endl;
+    state.counters["qps"] = responses / seconds;
+    state.counters["Migrations"] = migrations / seconds;
+}
+
+BENCHMARK(BM_loopbackServer)->Apply(loopbackCustomArguments);
+
+}  // namespace
+}  // namespace testing
+}  // namespace blocking_to_async
+
+int main(int argc, char** argv)
+{
+    using blocking_to_async::testing::ContinuousWorkload;
+    using blocking_to_async::testing::WorkloadRegistry;
+    auto& config = blocking_to_async::testing::config;
+    config.workload = WorkloadRegistry::workloadFromCommandLine(&argc, argv);
+    if (!ContinuousWorkload::flagsFromCommandLine(&argc, argv, &config)) {
+        return 1;
+    }
+    if (!WorkloadRegistry::instance().contains(config.workload)) {
+        std::cerr << "Unknown workload " << config.workload << ", available:";
+        for (const auto& name : WorkloadRegistry::instance().names()) {
+            std::cerr << " " << name;
+        }
+        std::cerr << std::endl;
+        return 1;
+    }
+    blocking_to_async::testing::raiseFileDescriptorLimit();
+    ::benchmark::Initialize(&argc, argv);
+    ::benchmark::RunSpecifiedBenchmarks();
+}
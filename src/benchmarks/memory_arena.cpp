@@ -0,0 +1,115 @@
+#include "benchmarks/memory_arena.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+#include "benchmarks/cpu_topology.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+constexpr size_t kHugePageSize = size_t{ 2 } << 20;
+
+size_t roundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+MemoryArena::MemoryArena(size_t size, const ArenaOptions& options)
+    : _size(size), _options(options) {
+    auto start = std::chrono::steady_clock::now();
+    size_t elements = size;
+    if (_options.fragmentBytes > 0) {
+        assert(std::has_single_bit(_options.fragmentBytes));
+        assert(_options.fragmentBytes >= sizeof(uint64_t));
+        size_t fragmentElements = _options.fragmentBytes / sizeof(uint64_t);
+        _fragmentShift = std::countr_zero(fragmentElements);
+        _fragmentMask = fragmentElements - 1;
+        elements = roundUp(size, fragmentElements);
+        size_t fragmentCount = elements / fragmentElements;
+        assert(fragmentCount <= UINT32_MAX);
+        _fragments.resize(fragmentCount);
+        std::iota(_fragments.begin(), _fragments.end(), 0);
+        std::shuffle(_fragments.begin(), _fragments.end(), std::mt19937());
+    }
+    _mappedBytes = roundUp(elements * sizeof(uint64_t), kHugePageSize);
+
+    void* address = MAP_FAILED;
+    if (_options.pages == ArenaOptions::Pages::kHugeTlb) {
+        address = mmap(nullptr, _mappedBytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        _hugeTlb = address != MAP_FAILED;
+        if (!_hugeTlb) {
+            std::cerr << "Failed to map " << _mappedBytes << " bytes of huge TLB pages, "
+                << "falling back to transparent huge pages" << std::endl;
+        }
+    }
+    if (address == MAP_FAILED) {
+        address = mmap(nullptr, _mappedBytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        assert(address != MAP_FAILED);
+        int advice = _options.pages == ArenaOptions::Pages::kSmall ?
+            MADV_NOHUGEPAGE : MADV_HUGEPAGE;
+        if (madvise(address, _mappedBytes, advice) != 0) {
+            std::cerr << "madvise for the arena failed" << std::endl;
+        }
+    }
+    _data = static_cast<uint64_t*>(address);
+    _prefault();
+
+    std::cerr << "Arena of " << _mappedBytes << " bytes ready in "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+}
+
+MemoryArena::~MemoryArena() {
+    int rc = munmap(_data, _mappedBytes);
+    assert(rc == 0);
+}
+
+void MemoryArena::_prefault() {
+    auto topology = CpuTopology::read();
+    int threadCount = _options.prefaultThreads > 0 ?
+        _options.prefaultThreads : std::max<int>(1, topology.cpus().size());
+    // Whole huge pages per thread so that no huge page is faulted by two threads.
+    size_t chunk = roundUp(_mappedBytes / threadCount, kHugePageSize);
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    auto* bytes = reinterpret_cast<volatile char*>(_data);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        size_t begin = i * chunk;
+        size_t end = std::min(begin + chunk, _mappedBytes);
+        if (begin >= end) {
+            break;
+        }
+        // Pinned so that the first touch places pages on the NUMA node of the CPU.
+        std::vector<int> cpu;
+        if (!topology.cpus().empty()) {
+            cpu.push_back(topology.cpus()[i % topology.cpus().size()].id);
+        }
+        threads.emplace_back([bytes, begin, end, pageSize, cpu] {
+            pinCurrentThread(cpu);
+            for (size_t offset = begin; offset < end; offset += pageSize) {
+                bytes[offset] = 0;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
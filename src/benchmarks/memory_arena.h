@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blocking_to_async {
+namespace testing {
+
+struct ArenaOptions {
+    enum class Pages {
+        // Regular pages, transparent huge pages are disabled for the arena.
+        kSmall,
+        // madvise(MADV_HUGEPAGE), needs transparent huge pages in "always" or "madvise".
+        kTransparentHuge,
+        // MAP_HUGETLB from the reserved pool, falls back to kTransparentHuge if the pool
+        // is too small.
+        kHugeTlb,
+    };
+
+    Pages pages = Pages::kTransparentHuge;
+    // Logical fragments of this many bytes are scattered over the arena in random order,
+    // 0 keeps the arena contiguous. Must be a power of two of at least 8 bytes.
+    size_t fragmentBytes = 0;
+    // Threads touching the pages before first use, 0 for one per online CPU.
+    int prefaultThreads = 0;
+
+    bool operator==(const ArenaOptions& other) const = default;
+};
+
+// Fixed size array of zero initialized uint64_t in one anonymous mapping.
+class MemoryArena {
+public:
+    MemoryArena(size_t size, const ArenaOptions& options);
+    ~MemoryArena();
+
+    MemoryArena(const MemoryArena&) = delete;
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    uint64_t& operator[](size_t index) {
+        if (_fragments.empty()) {
+            return _data[index];
+        }
+        return _data[(size_t{ _fragments[index >> _fragmentShift] } << _fragmentShift) |
+            (index & _fragmentMask)];
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    const ArenaOptions& options() const {
+        return _options;
+    }
+
+    // False if kHugeTlb fell back to transparent huge pages.
+    bool usesHugeTlb() const {
+        return _hugeTlb;
+    }
+
+private:
+    void _prefault();
+
+    const size_t _size;
+    const ArenaOptions _options;
+    uint64_t* _data = nullptr;
+    size_t _mappedBytes = 0;
+    bool _hugeTlb = false;
+
+    // Physical fragment of every logical fragment, empty when contiguous.
+    std::vector<uint32_t> _fragments;
+    int _fragmentShift = 0;
+    size_t _fragmentMask = 0;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,145 @@
+#include "benchmarks/perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <mutex>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+uint64_t hardwareCacheConfig(uint64_t cache, uint64_t operation, uint64_t result) {
+    return cache | (operation << 8) | (result << 16);
+}
+
+}  // namespace
+
+PerfCounts& PerfCounts::operator+=(const PerfCounts& other) {
+    contextSwitches += other.contextSwitches;
+    cpuMigrations += other.cpuMigrations;
+    pageFaults += other.pageFaults;
+    cycles += other.cycles;
+    instructions += other.instructions;
+    llcMisses += other.llcMisses;
+    dtlbMisses += other.dtlbMisses;
+    return *this;
+}
+
+PerfCounts& PerfCounts::operator-=(const PerfCounts& other) {
+    contextSwitches -= other.contextSwitches;
+    cpuMigrations -= other.cpuMigrations;
+    pageFaults -= other.pageFaults;
+    cycles -= other.cycles;
+    instructions -= other.instructions;
+    llcMisses -= other.llcMisses;
+    dtlbMisses -= other.dtlbMisses;
+    return *this;
+}
+
+PerfCounters::PerfCounters() {
+    _open(&_software, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES,
+          &PerfCounts::contextSwitches);
+    _open(&_software, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS,
+          &PerfCounts::cpuMigrations);
+    _open(&_software, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, &PerfCounts::pageFaults);
+
+    _open(&_hardware, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, &PerfCounts::cycles);
+    _open(&_hardware, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, &PerfCounts::instructions);
+    _open(&_hardware, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, &PerfCounts::llcMisses);
+    _open(&_hardware, PERF_TYPE_HW_CACHE,
+          hardwareCacheConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                              PERF_COUNT_HW_CACHE_RESULT_MISS),
+          &PerfCounts::dtlbMisses);
+}
+
+PerfCounters::~PerfCounters() {
+    for (const auto* group : { &_software, &_hardware }) {
+        for (int fd : group->fds) {
+            close(fd);
+        }
+    }
+}
+
+std::shared_ptr<PerfCounters> PerfCounters::forCurrentThread() {
+    // Every thread holds up to seven descriptors, hundreds of blocking threads would
+    // run out of the default soft limit.
+    static std::once_flag raiseLimitOnce;
+    std::call_once(raiseLimitOnce, [] {
+        rlimit limit;
+        getrlimit(RLIMIT_NOFILE, &limit);
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    });
+    static thread_local std::shared_ptr<PerfCounters> counters(new PerfCounters());
+    return counters;
+}
+
+void PerfCounters::_open(Group* group, uint32_t type, uint64_t config,
+                         int64_t PerfCounts::*field) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    // Only user space is counted, which works with the default `perf_event_paranoid`.
+    attr.exclude_kernel = type != PERF_TYPE_SOFTWARE;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    int fd = syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1 /* any CPU */,
+                     group->leader, 0);
+    if (fd < 0 && type == PERF_TYPE_SOFTWARE && errno == EACCES) {
+        attr.exclude_kernel = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, group->leader, 0);
+    }
+    if (fd < 0) {
+        static std::once_flag warnOnce;
+        std::call_once(warnOnce, [] {
+            std::cerr << "Some perf events are not available: " << strerror(errno) << std::endl;
+        });
+        return;
+    }
+    if (group->leader < 0) {
+        group->leader = fd;
+    }
+    group->fds.push_back(fd);
+    group->fields.push_back(field);
+}
+
+void PerfCounters::_read(const Group& group, PerfCounts* counts) {
+    if (group.leader < 0) {
+        return;
+    }
+    // Layout of PERF_FORMAT_GROUP with both total times.
+    struct {
+        uint64_t count;
+        uint64_t timeEnabled;
+        uint64_t timeRunning;
+        uint64_t values[8];
+    } data;
+    auto bytes = ::read(group.leader, &data, sizeof(data));
+    if (bytes <= 0 || data.count != group.fields.size() || data.timeRunning == 0) {
+        return;
+    }
+    double scale = double(data.timeEnabled) / data.timeRunning;
+    for (int i = 0; i < group.fields.size(); ++i) {
+        counts->*group.fields[i] += static_cast<int64_t>(data.values[i] * scale);
+    }
+}
+
+PerfCounts PerfCounters::read() const {
+    PerfCounts counts;
+    _read(_software, &counts);
+    _read(_hardware, &counts);
+    return counts;
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
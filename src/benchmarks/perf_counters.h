@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace blocking_to_async {
+namespace testing {
+
+// Values of the `perf_event_open` counters of one or more threads. Hardware events stay
+// zero where the PMU is not available, for example in most virtual machines.
+struct PerfCounts {
+    int64_t contextSwitches = 0;
+    int64_t cpuMigrations = 0;
+    int64_t pageFaults = 0;
+    int64_t cycles = 0;
+    int64_t instructions = 0;
+    int64_t llcMisses = 0;
+    int64_t dtlbMisses = 0;
+
+    PerfCounts& operator+=(const PerfCounts& other);
+    PerfCounts& operator-=(const PerfCounts& other);
+};
+
+// Counter groups of one thread: software events (context switches, CPU migrations,
+// page faults) in one group and hardware events (cycles, instructions, last level
+// cache and dTLB misses) in another, so that a missing PMU does not lose the
+// software events. Counts are scaled up when the kernel multiplexed the group.
+class PerfCounters {
+public:
+    ~PerfCounters();
+
+    // Counters of the calling thread, opened on the first call. The counters keep
+    // their final values after the thread exits.
+    static std::shared_ptr<PerfCounters> forCurrentThread();
+
+    // May be called from any thread.
+    PerfCounts read() const;
+
+private:
+    struct Group {
+        int leader = -1;
+        std::vector<int> fds;
+        // Field of `PerfCounts` of every event in the group order.
+        std::vector<int64_t PerfCounts::*> fields;
+    };
+
+    PerfCounters();
+
+    static void _open(Group* group, uint32_t type, uint64_t config, int64_t PerfCounts::*field);
+    static void _read(const Group& group, PerfCounts* counts);
+
+    Group _software;
+    Group _hardware;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
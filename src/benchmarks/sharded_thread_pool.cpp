@@ -0,0 +1,170 @@
+#include "benchmarks/sharded_thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "benchmarks/cpu_topology.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+thread_local const ShardedThreadPool* ShardedThreadPool::_currentPool = nullptr;
+thread_local int ShardedThreadPool::_currentShard = -1;
+
+namespace {
+
+CpuTopology::Level topologyLevel(ThreadPoolOptions::Pinning pinning) {
+    switch (pinning) {
+    case ThreadPoolOptions::Pinning::kPerCore:
+        return CpuTopology::Level::kCore;
+    case ThreadPoolOptions::Pinning::kPerLlc:
+        return CpuTopology::Level::kLlc;
+    case ThreadPoolOptions::Pinning::kPerNumaNode:
+    case ThreadPoolOptions::Pinning::kNone:
+        break;
+    }
+    return CpuTopology::Level::kNumaNode;
+}
+
+ThreadPoolOptions withoutPinning(ThreadPoolOptions options) {
+    options.pinning = ThreadPoolOptions::Pinning::kNone;
+    return options;
+}
+
+}  // namespace
+
+ShardedThreadPool::ShardedThreadPool(const ThreadPoolOptions& options)
+    : _shardOptions(withoutPinning(options)),
+      _domains(CpuTopology::read().domains(topologyLevel(options.pinning))) {
+    if (_domains.empty()) {
+        // Unknown topology, run a single unpinned shard.
+        _domains.emplace_back();
+    }
+}
+
+ShardedThreadPool::~ShardedThreadPool() = default;
+
+void ShardedThreadPool::start(int concurrency) {
+    assert(concurrency >= 1);
+    int shardCount = std::min<int>(_domains.size(), concurrency);
+    for (int shard = 0; shard < shardCount; ++shard) {
+        auto pool = ThreadPool::create(_shardOptions);
+        pool->setThreadStartHook([this, shard] {
+            pinCurrentThread(_domains[shard]);
+            _currentPool = this;
+            _currentShard = shard;
+        });
+        _shards.push_back(std::move(pool));
+    }
+    for (int shard = 0; shard < shardCount; ++shard) {
+        _shards[shard]->start(concurrency / shardCount + (shard < concurrency % shardCount));
+    }
+}
+
+bool ShardedThreadPool::isWarm() const {
+    return std::all_of(_shards.begin(), _shards.end(),
+                       [](const auto& shard) { return shard->isWarm(); });
+}
+
+void ShardedThreadPool::queueJob(Task&& job) {
+    int shard = currentShard();
+    if (shard < 0) {
+        shard = _nextShard.fetch_add(1, std::memory_order_relaxed) % _shards.size();
+    }
+    _shards[shard]->queueJob(std::move(job));
+}
+
+void ShardedThreadPool::queueJobToShard(int shard, Task&& job) {
+    if (shard < 0 || shard >= _shards.size()) {
+        queueJob(std::move(job));
+        return;
+    }
+    _shards[shard]->queueJob(std::move(job));
+}
+
+void ShardedThreadPool::queueJobs(std::span<Task> jobs, JobPriority priority) {
+    int shard = currentShard();
+    if (shard < 0) {
+        shard = _nextShard.fetch_add(1, std::memory_order_relaxed) % _shards.size();
+    }
+    _shards[shard]->queueJobs(jobs, priority);
+}
+
+void ShardedThreadPool::queueJobsToShard(int shard, std::span<Task> jobs, JobPriority priority) {
+    if (shard < 0 || shard >= _shards.size()) {
+        queueJobs(jobs, priority);
+        return;
+    }
+    _shards[shard]->queueJobs(jobs, priority);
+}
+
+void ShardedThreadPool::stop() {
+    for (auto& shard : _shards) {
+        shard->stop();
+    }
+}
+
+int ShardedThreadPool::queueSize() const {
+    int size = 0;
+    for (const auto& shard : _shards) {
+        size += shard->queueSize();
+    }
+    return size;
+}
+
+int ShardedThreadPool::currentlyRunning() const {
+    int running = 0;
+    for (const auto& shard : _shards) {
+        running += shard->currentlyRunning();
+    }
+    return running;
+}
+
+int ShardedThreadPool::spareCapacity() const {
+    int spare = 0;
+    for (const auto& shard : _shards) {
+        spare += shard->spareCapacity();
+    }
+    return spare;
+}
+
+ThreadPool::ThreadChurn ShardedThreadPool::threadChurn() const {
+    ThreadChurn churn;
+    for (const auto& shard : _shards) {
+        auto shardChurn = shard->threadChurn();
+        churn.spawned += shardChurn.spawned;
+        churn.retired += shardChurn.retired;
+    }
+    return churn;
+}
+
+ThreadPool::WakeupStats ShardedThreadPool::wakeupStats() const {
+    WakeupStats stats;
+    for (const auto& shard : _shards) {
+        stats += shard->wakeupStats();
+    }
+    return stats;
+}
+
+AdmissionStats ShardedThreadPool::admissionStats() const {
+    AdmissionStats stats;
+    for (const auto& shard : _shards) {
+        stats += shard->admissionStats();
+    }
+    return stats;
+}
+
+SchedStats ShardedThreadPool::schedStats() const {
+    SchedStats stats;
+    for (const auto& shard : _shards) {
+        stats += shard->schedStats();
+    }
+    return stats;
+}
+
+int ShardedThreadPool::currentShard() const {
+    return _currentPool == this ? _currentShard : -1;
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
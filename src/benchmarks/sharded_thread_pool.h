@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "benchmarks/thread_pool.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+// Splits the workers into one shard per topology domain (core, last level cache or NUMA
+// node). Each shard is an independent pool of the configured scheduler whose threads
+// are pinned to the domain's CPUs. Jobs queued by a worker stay on its shard, jobs
+// queued from outside are spread round robin over the shards.
+class ShardedThreadPool : public ThreadPool {
+public:
+    explicit ShardedThreadPool(const ThreadPoolOptions& options);
+    ~ShardedThreadPool() override;
+
+    // Threads are spread evenly over the shards. With fewer threads than domains only
+    // the first `concurrency` domains get a shard.
+    void start(int concurrency) override;
+    bool isWarm() const override;
+    void queueJob(Task&& job) override;
+    void queueJobs(std::span<Task> jobs, JobPriority priority) override;
+    void stop() override;
+    int queueSize() const override;
+    int currentlyRunning() const override;
+    int spareCapacity() const override;
+    ThreadChurn threadChurn() const override;
+    WakeupStats wakeupStats() const override;
+    AdmissionStats admissionStats() const override;
+    SchedStats schedStats() const override;
+
+    int currentShard() const override;
+    void queueJobToShard(int shard, Task&& job) override;
+    void queueJobsToShard(int shard, std::span<Task> jobs, JobPriority priority) override;
+
+    int shardCount() const {
+        return _shards.size();
+    }
+
+private:
+    const ThreadPoolOptions _shardOptions;
+    // CPU ids of every domain, indexed by shard.
+    std::vector<std::vector<int>> _domains;
+    std::vector<std::unique_ptr<ThreadPool>> _shards;
+    std::atomic<unsigned> _nextShard{0};
+
+    static thread_local const ShardedThreadPool* _currentPool;
+    static thread_local int _currentShard;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,110 @@
+#include "benchmarks/stats_recorder.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+std::atomic<uint64_t> nextRecorderId{ 1 };
+
+}  // namespace
+
+StatsRecorder::StatsRecorder() : _id(nextRecorderId++) {}
+
+StatsRecorder::Slot& StatsRecorder::_slot() {
+    // Threads write to one or two recorders, the last used one is checked first.
+    static thread_local std::vector<std::pair<uint64_t, Slot*>> threadSlots;
+    static thread_local std::pair<uint64_t, Slot*> lastUsed{ 0, nullptr };
+    if (lastUsed.first == _id) {
+        return *lastUsed.second;
+    }
+    auto it = std::find_if(threadSlots.begin(), threadSlots.end(),
+                           [this](const auto& entry) { return entry.first == _id; });
+    if (it == threadSlots.end()) {
+        std::lock_guard<std::mutex> lock(_slotsMutex);
+        _slots.push_back(std::make_unique<Slot>());
+        _slots.back()->perf = PerfCounters::forCurrentThread();
+        threadSlots.emplace_back(_id, _slots.back().get());
+        it = threadSlots.end() - 1;
+    }
+    lastUsed = *it;
+    return *it->second;
+}
+
+void StatsRecorder::add(uint64_t iterations, int64_t threadMigrations,
+                        std::chrono::microseconds duration) {
+    auto& slot = _slot();
+    // Only this thread writes the slot, relaxed loads see its own stores.
+    auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.iterations.store(slot.iterations.load(std::memory_order_relaxed) + iterations,
+                          std::memory_order_relaxed);
+    slot.threadMigrations.store(
+        slot.threadMigrations.load(std::memory_order_relaxed) + threadMigrations,
+        std::memory_order_relaxed);
+    slot.durationMicros.store(
+        slot.durationMicros.load(std::memory_order_relaxed) + duration.count(),
+        std::memory_order_relaxed);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+StatsRecorder::Counters StatsRecorder::_sumLocked() const {
+    Counters sum;
+    for (const auto& slot : _slots) {
+        while (true) {
+            auto before = slot->sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            auto iterations = slot->iterations.load(std::memory_order_relaxed);
+            auto threadMigrations = slot->threadMigrations.load(std::memory_order_relaxed);
+            auto durationMicros = slot->durationMicros.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->sequence.load(std::memory_order_relaxed) != before) {
+                continue;
+            }
+            sum.iterations += iterations;
+            sum.threadMigrations += threadMigrations;
+            sum.duration += std::chrono::microseconds(durationMicros);
+            break;
+        }
+        sum.perf += slot->perf->read();
+    }
+    return sum;
+}
+
+StatsRecorder::Counters StatsRecorder::counters() const {
+    std::lock_guard<std::mutex> lock(_slotsMutex);
+    auto sum = _sumLocked();
+    sum.iterations -= _baseline.iterations;
+    sum.threadMigrations -= _baseline.threadMigrations;
+    sum.duration -= _baseline.duration;
+    sum.perf -= _baseline.perf;
+    return sum;
+}
+
+RequestLatencies StatsRecorder::latencies() const {
+    RequestLatencies result;
+    std::lock_guard<std::mutex> lock(_slotsMutex);
+    for (const auto& slot : _slots) {
+        std::lock_guard<std::mutex> slotLock(slot->latenciesMutex);
+        result.merge(slot->latencies);
+    }
+    return result;
+}
+
+void StatsRecorder::reset() {
+    std::lock_guard<std::mutex> lock(_slotsMutex);
+    _baseline = _sumLocked();
+    for (const auto& slot : _slots) {
+        std::lock_guard<std::mutex> slotLock(slot->latenciesMutex);
+        slot->latencies.reset();
+    }
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "benchmarks/latency_histogram.h"
+#include "benchmarks/perf_counters.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+// Counters and latencies of a workload written by many threads. Every writer thread
+// owns a cache line aligned slot: counters are published through a per slot seqlock
+// and histograms are guarded by a per slot mutex that only the owner and readers
+// take, so writers never contend with each other. Slots also carry the perf counters
+// of their thread.
+class StatsRecorder {
+public:
+    struct Counters {
+        uint64_t iterations = 0;
+        int64_t threadMigrations = 0;
+        // Sum of the durations passed to `add()`.
+        std::chrono::microseconds duration{ 0 };
+        // Whole thread counters of all writer threads.
+        PerfCounts perf;
+    };
+
+    StatsRecorder();
+
+    // Adds to the counters of the calling thread.
+    void add(uint64_t iterations, int64_t threadMigrations,
+             std::chrono::microseconds duration = std::chrono::microseconds{ 0 });
+
+    // Calls `record(RequestLatencies&)` on the latencies of the calling thread.
+    template <typename Recorder>
+    void recordLatencies(Recorder&& record) {
+        auto& slot = _slot();
+        std::lock_guard<std::mutex> lock(slot.latenciesMutex);
+        record(slot.latencies);
+    }
+
+    // Totals since the last `reset()`.
+    Counters counters() const;
+    RequestLatencies latencies() const;
+
+    // Counters are rebased instead of cleared so that writers stay the only writers
+    // of their slots.
+    void reset();
+
+private:
+    struct alignas(64) Slot {
+        // Odd while the owner updates the counters below.
+        std::atomic<uint64_t> sequence{ 0 };
+        std::atomic<uint64_t> iterations{ 0 };
+        std::atomic<int64_t> threadMigrations{ 0 };
+        std::atomic<int64_t> durationMicros{ 0 };
+
+        std::mutex latenciesMutex;
+        RequestLatencies latencies;
+
+        std::shared_ptr<PerfCounters> perf;
+    };
+
+    Slot& _slot();
+    // Must be called under `_slotsMutex`.
+    Counters _sumLocked() const;
+
+    // Distinguishes recorders in the thread local slot caches, addresses are reused.
+    const uint64_t _id;
+    mutable std::mutex _slotsMutex;
+    std::vector<std::unique_ptr<Slot>> _slots;
+    Counters _baseline;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
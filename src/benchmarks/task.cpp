@@ -0,0 +1,135 @@
+#include "benchmarks/task.h"
+
+#include <mutex>
+#include <vector>
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+static_assert(sizeof(JobNode) == 128, "a job node should span two cache lines");
+
+// Nodes move between threads in batches of this size.
+constexpr int kBatchSize = 64;
+
+// Memory of a node that is not in use.
+struct FreeNode {
+    FreeNode* next;
+};
+
+struct Batch {
+    FreeNode* head;
+    int count;
+};
+
+// Shared by all threads, never destroyed so that thread local caches of exiting threads
+// can return their nodes at any time.
+class Depot {
+public:
+    static Depot& instance() {
+        static Depot* depot = new Depot();
+        return *depot;
+    }
+
+    void put(Batch batch) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _batches.push_back(batch);
+    }
+
+    // Takes a batch, or carves a new slab when the depot is empty.
+    Batch take() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_batches.empty()) {
+                auto batch = _batches.back();
+                _batches.pop_back();
+                return batch;
+            }
+        }
+        auto* slab = static_cast<unsigned char*>(
+            ::operator new(sizeof(JobNode) * kBatchSize, std::align_val_t(alignof(JobNode))));
+        FreeNode* head = nullptr;
+        for (int i = kBatchSize - 1; i >= 0; --i) {
+            auto* node = reinterpret_cast<FreeNode*>(slab + i * sizeof(JobNode));
+            node->next = head;
+            head = node;
+        }
+        return { head, kBatchSize };
+    }
+
+private:
+    std::mutex _mutex;
+    std::vector<Batch> _batches;
+};
+
+class ThreadCache {
+public:
+    ~ThreadCache() {
+        while (_count > 0) {
+            Depot::instance().put(_split(std::min(_count, kBatchSize)));
+        }
+    }
+
+    void* allocate() {
+        if (!_head) {
+            auto batch = Depot::instance().take();
+            _head = batch.head;
+            _count = batch.count;
+        }
+        FreeNode* node = _head;
+        _head = node->next;
+        --_count;
+        return node;
+    }
+
+    void release(void* memory) {
+        auto* node = static_cast<FreeNode*>(memory);
+        node->next = _head;
+        _head = node;
+        // Threads that only consume jobs hand their surplus to the producers.
+        if (++_count >= 2 * kBatchSize) {
+            Depot::instance().put(_split(kBatchSize));
+        }
+    }
+
+private:
+    Batch _split(int count) {
+        FreeNode* head = _head;
+        FreeNode* last = head;
+        for (int i = 1; i < count; ++i) {
+            last = last->next;
+        }
+        _head = last->next;
+        last->next = nullptr;
+        _count -= count;
+        return { head, count };
+    }
+
+    FreeNode* _head = nullptr;
+    int _count = 0;
+};
+
+thread_local ThreadCache threadCache;
+
+}  // namespace
+
+JobNode* JobNode::allocate(Task&& task) {
+    auto* node = new (threadCache.allocate()) JobNode();
+    node->task = std::move(task);
+    return node;
+}
+
+void JobNode::release(JobNode* node) {
+    node->~JobNode();
+    threadCache.release(node);
+}
+
+JobQueue::~JobQueue() {
+    while (auto node = pop()) {
+        JobNode::release(node);
+    }
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
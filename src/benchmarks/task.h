@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace blocking_to_async {
+namespace testing {
+
+// Move-only `void()` callable for thread pool jobs. Callables up to `kInlineSize` bytes
+// are stored inline, which covers every job of the workloads, larger ones go to the heap.
+class Task {
+public:
+    static constexpr size_t kInlineSize = 96;
+
+    Task() = default;
+
+    template <typename F,
+              typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task> &&
+                                          std::is_invocable_r_v<void, std::decay_t<F>&>>>
+    Task(F&& f) {
+        using Callable = std::decay_t<F>;
+        if constexpr (sizeof(Callable) <= kInlineSize &&
+                      alignof(Callable) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible_v<Callable>) {
+            new (_storage) Callable(std::forward<F>(f));
+            _ops = &kInlineOps<Callable>;
+        } else {
+            *reinterpret_cast<Callable**>(_storage) = new Callable(std::forward<F>(f));
+            _ops = &kHeapOps<Callable>;
+        }
+    }
+
+    Task(Task&& other) noexcept {
+        _moveFrom(other);
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            _reset();
+            _moveFrom(other);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        _reset();
+    }
+
+    explicit operator bool() const {
+        return _ops != nullptr;
+    }
+
+    void operator()() {
+        assert(_ops);
+        _ops->invoke(_storage);
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        // Move constructs into `to` and destroys `from`.
+        void (*relocate)(void* from, void* to);
+        void (*destroy)(void* storage);
+    };
+
+    template <typename Callable>
+    static constexpr Ops kInlineOps{
+        [](void* storage) { (*static_cast<Callable*>(storage))(); },
+        [](void* from, void* to) {
+            new (to) Callable(std::move(*static_cast<Callable*>(from)));
+            static_cast<Callable*>(from)->~Callable();
+        },
+        [](void* storage) { static_cast<Callable*>(storage)->~Callable(); },
+    };
+
+    template <typename Callable>
+    static constexpr Ops kHeapOps{
+        [](void* storage) { (**static_cast<Callable**>(storage))(); },
+        [](void* from, void* to) {
+            *static_cast<Callable**>(to) = *static_cast<Callable**>(from);
+        },
+        [](void* storage) { delete *static_cast<Callable**>(storage); },
+    };
+
+    void _moveFrom(Task& other) {
+        _ops = other._ops;
+        if (_ops) {
+            _ops->relocate(other._storage, _storage);
+            other._ops = nullptr;
+        }
+    }
+
+    void _reset() {
+        if (_ops) {
+            _ops->destroy(_storage);
+            _ops = nullptr;
+        }
+    }
+
+    const Ops* _ops = nullptr;
+    alignas(std::max_align_t) unsigned char _storage[kInlineSize];
+};
+
+// Queued task in an intrusive list. Nodes are recycled through a free list of the
+// thread that releases them, balanced over threads by a global depot of batches, so
+// queueing a job does not reach the allocator in the steady state.
+struct alignas(64) JobNode {
+    JobNode* next = nullptr;
+    // Set by pools that track the queueing delay, fills the padding before `task`.
+    std::chrono::steady_clock::time_point queuedAt;
+    Task task;
+
+    static JobNode* allocate(Task&& task);
+    static void release(JobNode* node);
+};
+
+// FIFO of job nodes, not thread safe. Releases the nodes left at destruction.
+class JobQueue {
+public:
+    JobQueue() = default;
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+    ~JobQueue();
+
+    void push(JobNode* node) {
+        node->next = nullptr;
+        if (_tail) {
+            _tail->next = node;
+        } else {
+            _head = node;
+        }
+        _tail = node;
+        ++_size;
+    }
+
+    // Moves all nodes of `other` to the back of this queue.
+    void splice(JobQueue& other) {
+        if (other.empty()) {
+            return;
+        }
+        if (_tail) {
+            _tail->next = other._head;
+        } else {
+            _head = other._head;
+        }
+        _tail = other._tail;
+        _size += other._size;
+        other._head = other._tail = nullptr;
+        other._size = 0;
+    }
+
+    // Null when empty.
+    JobNode* pop() {
+        JobNode* node = _head;
+        if (node) {
+            _head = node->next;
+            if (!_head) {
+                _tail = nullptr;
+            }
+            --_size;
+        }
+        return node;
+    }
+
+    bool empty() const {
+        return _head == nullptr;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+private:
+    JobNode* _head = nullptr;
+    JobNode* _tail = nullptr;
+    size_t _size = 0;
+};
+
+enum class JobPriority {
+    // Continuations of requests that already waited, they run before new admissions.
+    kHigh,
+    kNormal,
+};
+
+// One FIFO per priority, pops from the highest priority first. Not thread safe.
+class PriorityJobQueue {
+public:
+    void push(JobNode* node, JobPriority priority) {
+        _queues[static_cast<int>(priority)].push(node);
+    }
+
+    void splice(JobQueue& other, JobPriority priority) {
+        _queues[static_cast<int>(priority)].splice(other);
+    }
+
+    // Null when empty. Sets `priority` to the priority of the popped job when given.
+    JobNode* pop(JobPriority* priority = nullptr) {
+        for (int i = 0; i < 2; ++i) {
+            if (auto node = _queues[i].pop()) {
+                if (priority) {
+                    *priority = static_cast<JobPriority>(i);
+                }
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    // Oldest job of `priority`, null when there is none.
+    JobNode* pop(JobPriority priority) {
+        return _queues[static_cast<int>(priority)].pop();
+    }
+
+    bool empty() const {
+        return _queues[0].empty() && _queues[1].empty();
+    }
+
+    size_t size() const {
+        return _queues[0].size() + _queues[1].size();
+    }
+
+    size_t size(JobPriority priority) const {
+        return _queues[static_cast<int>(priority)].size();
+    }
+
+private:
+    JobQueue _queues[2];
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,92 @@
+#include "benchmarks/thread_cpu_accounting.h"
+
+#include <fstream>
+#include <pthread.h>
+#include <string>
+#include <unistd.h>
+
+namespace blocking_to_async {
+namespace testing {
+
+SchedStats& SchedStats::operator+=(const SchedStats& other) {
+    wall += other.wall;
+    onCpu += other.onCpu;
+    runQueueWait += other.runQueueWait;
+    voluntarySwitches += other.voluntarySwitches;
+    involuntarySwitches += other.involuntarySwitches;
+    return *this;
+}
+
+SchedStats& SchedStats::operator-=(const SchedStats& other) {
+    wall -= other.wall;
+    onCpu -= other.onCpu;
+    runQueueWait -= other.runQueueWait;
+    voluntarySwitches -= other.voluntarySwitches;
+    involuntarySwitches -= other.involuntarySwitches;
+    return *this;
+}
+
+ThreadCpuAccounting::ThreadCpuAccounting()
+    : _tid(gettid()),
+      _started(std::chrono::steady_clock::now()) {
+    // The clock id encodes the tid and stays usable after `pthread_self()` is gone.
+    int rc = pthread_getcpuclockid(pthread_self(), &_cpuClock);
+    if (rc != 0) {
+        _exited = true;
+    }
+}
+
+SchedStats ThreadCpuAccounting::read() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_exited) {
+        return _last;
+    }
+
+    SchedStats stats;
+    timespec cpuTime;
+    auto taskPath = "/proc/self/task/" + std::to_string(_tid);
+    std::ifstream schedstat(taskPath + "/schedstat");
+    std::ifstream status(taskPath + "/status");
+    // Both fail once the thread exited.
+    if (clock_gettime(_cpuClock, &cpuTime) != 0 || !schedstat.is_open() || !status.is_open()) {
+        _exited = true;
+        return _last;
+    }
+    stats.wall = std::chrono::steady_clock::now() - _started;
+    stats.onCpu = std::chrono::seconds(cpuTime.tv_sec) + std::chrono::nanoseconds(cpuTime.tv_nsec);
+
+    // Time on CPU, time waiting on a run queue and count of time slices, in ns.
+    int64_t schedOnCpu = 0;
+    int64_t schedRunQueueWait = 0;
+    schedstat >> schedOnCpu >> schedRunQueueWait;
+    stats.runQueueWait = std::chrono::nanoseconds(schedRunQueueWait);
+
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("voluntary_ctxt_switches:", 0) == 0) {
+            stats.voluntarySwitches = std::stoll(line.substr(line.find(':') + 1));
+        } else if (line.rfind("nonvoluntary_ctxt_switches:", 0) == 0) {
+            stats.involuntarySwitches = std::stoll(line.substr(line.find(':') + 1));
+        }
+    }
+    _last = stats;
+    return stats;
+}
+
+void ThreadCpuAccountingGroup::addCurrentThread() {
+    auto accounting = std::make_unique<ThreadCpuAccounting>();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _threads.push_back(std::move(accounting));
+}
+
+SchedStats ThreadCpuAccountingGroup::read() const {
+    SchedStats sum;
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& thread : _threads) {
+        sum += thread->read();
+    }
+    return sum;
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <sys/types.h>
+#include <vector>
+
+namespace blocking_to_async {
+namespace testing {
+
+// Where the time of threads went.
+struct SchedStats {
+    // Time since the accounting of the threads started.
+    std::chrono::nanoseconds wall{ 0 };
+    // Running on a CPU, from `CLOCK_THREAD_CPUTIME_ID`.
+    std::chrono::nanoseconds onCpu{ 0 };
+    // Runnable but waiting for a CPU, from `/proc/self/task/<tid>/schedstat`.
+    std::chrono::nanoseconds runQueueWait{ 0 };
+    int64_t voluntarySwitches = 0;
+    int64_t involuntarySwitches = 0;
+
+    // Blocked or sleeping.
+    std::chrono::nanoseconds offCpu() const {
+        return wall - onCpu - runQueueWait;
+    }
+
+    SchedStats& operator+=(const SchedStats& other);
+    SchedStats& operator-=(const SchedStats& other);
+};
+
+// Accounting of one thread, readable from any thread. Once the thread exits its stats
+// stay at the last successful read.
+class ThreadCpuAccounting {
+public:
+    // Starts the accounting of the calling thread.
+    ThreadCpuAccounting();
+
+    SchedStats read() const;
+
+private:
+    const pid_t _tid;
+    clockid_t _cpuClock;
+    const std::chrono::steady_clock::time_point _started;
+
+    mutable std::mutex _mutex;
+    mutable SchedStats _last;
+    mutable bool _exited = false;
+};
+
+// Accounting of a set of threads, for example the workers of a pool.
+class ThreadCpuAccountingGroup {
+public:
+    void addCurrentThread();
+
+    SchedStats read() const;
+
+private:
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<ThreadCpuAccounting>> _threads;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
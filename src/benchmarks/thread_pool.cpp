@@ -1,95 +1,432 @@
 #include "benchmarks/thread_pool.h"
+#include <algorithm>
 #include <iostream>
+#include <optional>
 #include <ostream>
+#include <x86intrin.h>
+
+#include "benchmarks/elastic_thread_pool.h"
+#include "benchmarks/sharded_thread_pool.h"
+#include "benchmarks/work_stealing_thread_pool.h"
 
 namespace blocking_to_async {
 namespace testing {
 
-void ThreadPool::start(int concurrency) {
+std::unique_ptr<ThreadPool> ThreadPool::create(const ThreadPoolOptions& options) {
+    if (options.pinning != ThreadPoolOptions::Pinning::kNone) {
+        // The shards are created with the same options and own the slots.
+        return std::make_unique<ShardedThreadPool>(options);
+    }
+    std::unique_ptr<ThreadPool> pool;
+    switch (options.scheduler) {
+    case ThreadPoolOptions::Scheduler::kSharedQueue:
+        pool = std::make_unique<SharedQueueThreadPool>(
+            options.dequeueBatch, options.idle, options.admission);
+        break;
+    case ThreadPoolOptions::Scheduler::kWorkStealing:
+        pool = std::make_unique<WorkStealingThreadPool>(options.dequeueBatch);
+        break;
+    case ThreadPoolOptions::Scheduler::kElastic:
+        pool = std::make_unique<ElasticThreadPool>(options.elastic, options.dequeueBatch);
+        break;
+    }
+    if (options.admission.enabled() &&
+        options.scheduler != ThreadPoolOptions::Scheduler::kSharedQueue) {
+        std::cerr << "Admission control is only supported by the shared queue scheduler"
+                  << std::endl;
+    }
+    if (pool) {
+        pool->_lifoSlot = options.lifoSlot;
+        pool->_lifoSlotTakesNormal = !options.admission.enabled();
+    }
+    return pool;
+}
+
+thread_local ThreadPool::Worker ThreadPool::_worker;
+thread_local bool ThreadPool::_shedding = false;
+
+ThreadPool::WakeupStats& ThreadPool::WakeupStats::operator+=(const WakeupStats& other) {
+    wakeups += other.wakeups;
+    spuriousWakeups += other.spuriousWakeups;
+    timeToWake += other.timeToWake;
+    spinHits += other.spinHits;
+    return *this;
+}
+
+ThreadPool::WakeupStats& ThreadPool::WakeupStats::operator-=(const WakeupStats& other) {
+    wakeups -= other.wakeups;
+    spuriousWakeups -= other.spuriousWakeups;
+    timeToWake -= other.timeToWake;
+    spinHits -= other.spinHits;
+    return *this;
+}
+
+void ThreadPool::_onThreadExit() {
+    if (_worker.next) {
+        JobNode::release(_worker.next);
+    }
+    _worker = Worker{};
+}
+
+JobNode* ThreadPool::_offerNextJob(JobNode* job, JobPriority* priority) {
+    if (!_lifoSlot || _worker.pool != this || _worker.streak >= kMaxNextJobStreak ||
+        (*priority == JobPriority::kNormal && !_lifoSlotTakesNormal)) {
+        return job;
+    }
+    std::swap(job, _worker.next);
+    std::swap(*priority, _worker.nextPriority);
+    return job;
+}
+
+JobNode* ThreadPool::_takeNextJob() {
+    JobNode* job = _worker.next;
+    if (job) {
+        _worker.next = nullptr;
+        ++_worker.streak;
+    } else {
+        _worker.streak = 0;
+    }
+    return job;
+}
+
+void ThreadPool::_shed(JobQueue& jobs) {
+    if (jobs.empty()) {
+        return;
+    }
+    _shedding = true;
+    while (auto job = jobs.pop()) {
+        job->task();
+        JobNode::release(job);
+    }
+    _shedding = false;
+}
+
+thread_local JobBatch JobBatch::_current;
+
+JobBatch::Scope::Scope() {
+    ++_current._depth;
+}
+
+JobBatch::Scope::~Scope() {
+    if (--_current._depth == 0) {
+        _current._flush();
+    }
+}
+
+void JobBatch::queue(ThreadPool* pool, int shard, std::span<Task> jobs, JobPriority priority) {
+    auto& batch = _current;
+    if (batch._depth == 0) {
+        pool->queueJobsToShard(shard, jobs, priority);
+        return;
+    }
+    auto group = std::find_if(batch._groups.begin(), batch._groups.end(), [&](const Group& g) {
+        return g.pool == pool && g.shard == shard && g.priority == priority;
+    });
+    if (group == batch._groups.end()) {
+        batch._groups.push_back({ pool, shard, priority, {} });
+        group = batch._groups.end() - 1;
+    }
+    for (auto& job : jobs) {
+        group->jobs.push_back(std::move(job));
+    }
+}
+
+void JobBatch::_flush() {
+    static constexpr size_t kMaxIdleGroups = 16;
+    for (auto& group : _groups) {
+        if (!group.jobs.empty()) {
+            group.pool->queueJobsToShard(group.shard, group.jobs, group.priority);
+            group.jobs.clear();
+        }
+    }
+    // Pools come and go between benchmarks, forget the groups of old ones.
+    if (_groups.size() > kMaxIdleGroups) {
+        _groups.clear();
+    }
+}
+
+SharedQueueThreadPool::SharedQueueThreadPool(int dequeueBatch,
+                                             const ThreadPoolOptions::IdleOptions& idle,
+                                             const AdmissionOptions& admission)
+    : _dequeueBatch(std::max(1, dequeueBatch)), _idle(idle), _admission(admission) {}
+
+void SharedQueueThreadPool::start(int concurrency) {
     _capacity = concurrency;
+    for (int i = 0; i < concurrency; ++i) {
+        _workers.push_back(std::make_unique<IdleWorker>());
+    }
+    _idleWorkers.reserve(concurrency);
+    _maxSpinningWorkers = _idle.maxSpinningWorkers > 0
+        ? _idle.maxSpinningWorkers
+        : std::max<int>(1, std::thread::hardware_concurrency() / 2);
     _threads.resize(concurrency);
     for (uint32_t i = 0; i < concurrency; i++) {
         _threads.at(i) = std::thread([this, i] { _threadLoop(i); });
     }
 }
 
-bool ThreadPool::isWarm() const {
+bool SharedQueueThreadPool::isWarm() const {
     return _startedThreads == _capacity;
 }
 
-void ThreadPool::queueJob(const std::function<void()>& job) {
-    bool shouldNotify = false;
+void SharedQueueThreadPool::queueJob(Task&& job) {
+    auto priority = JobPriority::kNormal;
+    auto node = _offerNextJob(JobNode::allocate(std::move(job)), &priority);
+    if (!node) {
+        return;
+    }
+    if (_admission.tracksDelay()) {
+        node->queuedAt = std::chrono::steady_clock::now();
+    }
+    IdleWorker* toWake = nullptr;
+    JobQueue shed;
     {
         std::unique_lock<std::mutex> lock(_queueMutex);
-        shouldNotify = _jobs.size() > 1 || _currentlyRunning.load() < std::max(8, _capacity / 4);
-        //shouldNotify = true;
-        _jobs.push(job);
-        if (_jobs.size() > 20 || (_jobs.size() > 5 && _currentlyRunning < _capacity / 2)) {
-            // std::cerr << "Warning " << _jobs.size() << " jobs in queue, running " << _currentlyRunning << std::endl;
+        _queueNode(node, priority, &shed);
+        _queuedJobs.store(_jobs.size(), std::memory_order_relaxed);
+        toWake = _popIdleWorker();
+    }
+    if (toWake) {
+        toWake->parker.unpark();
+    }
+    _shed(shed);
+}
+
+void SharedQueueThreadPool::queueJobs(std::span<Task> jobs, JobPriority priority) {
+    bool admits = priority == JobPriority::kNormal && _admission.enabled();
+    std::chrono::steady_clock::time_point now;
+    if (admits && _admission.tracksDelay()) {
+        now = std::chrono::steady_clock::now();
+    }
+    JobQueue batch;
+    // A job of the other priority displaced from the next job slot.
+    JobNode* displaced = nullptr;
+    auto displacedPriority = priority;
+    for (auto& job : jobs) {
+        auto nodePriority = priority;
+        if (auto node = _offerNextJob(JobNode::allocate(std::move(job)), &nodePriority)) {
+            node->queuedAt = now;
+            if (nodePriority == priority) {
+                batch.push(node);
+            } else {
+                displaced = node;
+                displacedPriority = nodePriority;
+            }
         }
     }
-    if (shouldNotify) {
-        _mutexCondition.notify_one();
+    if (batch.empty() && !displaced) {
+        return;
     }
+    JobQueue shed;
+    {
+        std::unique_lock<std::mutex> lock(_queueMutex);
+        if (displaced) {
+            _queueNode(displaced, displacedPriority, &shed);
+        }
+        if (admits) {
+            while (auto node = batch.pop()) {
+                _admit(node, &shed);
+            }
+        } else {
+            _jobs.splice(batch, priority);
+        }
+        _queuedJobs.store(_jobs.size(), std::memory_order_relaxed);
+        // Unparked under the lock, a batch may wake several workers.
+        while (auto toWake = _popIdleWorker()) {
+            toWake->parker.unpark();
+        }
+    }
+    _shed(shed);
 }
 
-void ThreadPool::stop() {
+void SharedQueueThreadPool::stop() {
     {
         std::unique_lock<std::mutex> lock(_queueMutex);
         _shouldTerminate = true;
+        for (auto worker : _idleWorkers) {
+            worker->wakeRequestedAt = std::chrono::steady_clock::now();
+            worker->parker.unpark();
+        }
+        _wakingWorkers += _idleWorkers.size();
+        _idleWorkers.clear();
     }
-    _mutexCondition.notify_all();
     for (std::thread& active_thread : _threads) {
         active_thread.join();
     }
     _threads.clear();
 }
 
-int ThreadPool::queueSize() const {
+int SharedQueueThreadPool::queueSize() const {
     std::unique_lock<std::mutex> lock(_queueMutex);
     return _jobs.size();
 }
 
-int ThreadPool::currentlyRunning() const {
+int SharedQueueThreadPool::currentlyRunning() const {
     return _currentlyRunning;
 }
 
-int ThreadPool::spareCapacity() const {
+int SharedQueueThreadPool::spareCapacity() const {
     return _capacity - _currentlyRunning;
 }
 
+ThreadPool::WakeupStats SharedQueueThreadPool::wakeupStats() const {
+    return { _wakeups.load(), _spuriousWakeups.load(),
+             std::chrono::nanoseconds(_timeToWakeNanos.load()), _spinHits.load() };
+}
+
+AdmissionStats SharedQueueThreadPool::admissionStats() const {
+    return _admission.stats();
+}
+
+void SharedQueueThreadPool::_queueNode(JobNode* node, JobPriority priority, JobQueue* shed) {
+    if (priority == JobPriority::kNormal) {
+        _admit(node, shed);
+    } else {
+        _jobs.push(node, priority);
+    }
+}
+
+void SharedQueueThreadPool::_admit(JobNode* node, JobQueue* shed) {
+    switch (_admission.onQueue(_jobs.size(JobPriority::kNormal))) {
+    case AdmissionController::Verdict::kAdmit:
+        break;
+    case AdmissionController::Verdict::kReject:
+        shed->push(node);
+        return;
+    case AdmissionController::Verdict::kShedOldest:
+        shed->push(_jobs.pop(JobPriority::kNormal));
+        break;
+    }
+    _jobs.push(node, JobPriority::kNormal);
+}
 
+SharedQueueThreadPool::IdleWorker* SharedQueueThreadPool::_popIdleWorker() {
+    if (_idleWorkers.empty() ||
+        _jobs.size() <= _wakingWorkers + _spinningWorkers.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    auto worker = _idleWorkers.back();
+    _idleWorkers.pop_back();
+    ++_wakingWorkers;
+    worker->wakeRequestedAt = std::chrono::steady_clock::now();
+    return worker;
+}
 
-void ThreadPool::_threadLoop(int threadId) {
+bool SharedQueueThreadPool::_pollForJobs() {
+    using Clock = std::chrono::steady_clock;
+    if (_idle.spinFor.count() == 0 && _idle.yieldFor.count() == 0) {
+        return false;
+    }
+    if (_spinningWorkers.fetch_add(1, std::memory_order_relaxed) >= _maxSpinningWorkers) {
+        _spinningWorkers.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    auto start = Clock::now();
+    auto spinUntil = start + _idle.spinFor;
+    auto yieldUntil = spinUntil + _idle.yieldFor;
+    bool found = false;
+    // Spinning reads the clock every few polls only, a yield is slow enough to read it
+    // every time.
+    static constexpr int kPollsPerClockRead = 64;
+    bool pastSpin = _idle.spinFor.count() == 0;
+    for (int polls = 1;; ++polls) {
+        if (_queuedJobs.load(std::memory_order_relaxed) > 0) {
+            found = true;
+            break;
+        }
+        if (!pastSpin) {
+            if (polls % kPollsPerClockRead != 0 || Clock::now() < spinUntil) {
+                _mm_pause();
+                continue;
+            }
+            pastSpin = true;
+        }
+        if (Clock::now() >= yieldUntil) {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    // The worker takes the lock next, a queueing thread that did not wake anyone
+    // because of this poller is covered by the check under the lock.
+    _spinningWorkers.fetch_sub(1, std::memory_order_relaxed);
+    return found;
+}
+
+void SharedQueueThreadPool::_park(IdleWorker* worker, std::unique_lock<std::mutex>& lock) {
+    _idleWorkers.push_back(worker);
+    lock.unlock();
+    worker->parker.park();
+    auto wokenAt = std::chrono::steady_clock::now();
+    lock.lock();
+    --_wakingWorkers;
+    _wakeups.fetch_add(1, std::memory_order_relaxed);
+    _timeToWakeNanos.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(wokenAt - worker->wakeRequestedAt)
+            .count(),
+        std::memory_order_relaxed);
+    if (_jobs.empty() && !_shouldTerminate) {
+        // A busy worker took the job first.
+        _spuriousWakeups.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SharedQueueThreadPool::_threadLoop(int threadId) {
+    _onThreadStart();
     ++_startedThreads;
     int count = 0;
+    auto idleWorker = _workers[threadId].get();
+    std::vector<JobNode*> batch;
+    batch.reserve(_dequeueBatch);
+    JobQueue shed;
     while (true) {
-        std::function<void()> job;
-        bool shouldNotify = false;
-        {
+        if (auto next = _takeNextJob()) {
+            batch.push_back(next);
+        } else {
+            bool polled = _queuedJobs.load(std::memory_order_relaxed) == 0 && _pollForJobs();
             std::unique_lock<std::mutex> lock(_queueMutex);
-            if (_jobs.empty()) {
-                _mutexCondition.wait(lock, [this] {
-                    return !_jobs.empty() || _shouldTerminate;
-                });
+            if (polled && !_jobs.empty()) {
+                _spinHits.fetch_add(1, std::memory_order_relaxed);
+            }
+            while (_jobs.empty() && !_shouldTerminate) {
+                _park(idleWorker, lock);
             }
             if (_shouldTerminate) {
                 // std::cerr << "Thread " << threadId << " executed " << count << " jobs" << std::endl;
+                _onThreadExit();
                 return;
             }
-            job = _jobs.front();
-            _jobs.pop();
-            if (!_jobs.empty()) {
-                shouldNotify = true;
+            // Leave the other workers their share of the backlog.
+            size_t take = std::min<size_t>(_dequeueBatch, (_jobs.size() + _capacity - 1) / _capacity);
+            std::chrono::steady_clock::time_point now;
+            if (_admission.tracksDelay()) {
+                now = std::chrono::steady_clock::now();
             }
+            for (size_t i = 0; i < take; ++i) {
+                JobPriority priority;
+                auto job = _jobs.pop(&priority);
+                if (priority == JobPriority::kNormal && _admission.tracksDelay() &&
+                    _admission.onDequeue(job->queuedAt, now, _jobs.size(JobPriority::kNormal))) {
+                    shed.push(job);
+                } else {
+                    batch.push_back(job);
+                }
+            }
+            _queuedJobs.store(_jobs.size(), std::memory_order_relaxed);
+        }
+        _shed(shed);
+        // Jobs queued by a batch are handed over together when it completes.
+        std::optional<JobBatch::Scope> scope;
+        if (batch.size() > 1) {
+            scope.emplace();
         }
-        if (shouldNotify) {
-            _mutexCondition.notify_one();
+        for (auto job : batch) {
+            ++_currentlyRunning;
+            job->task();
+            --_currentlyRunning;
+            JobNode::release(job);
+            ++count;
         }
-        ++_currentlyRunning;
-        job();
-        --_currentlyRunning;
-        ++count;
+        batch.clear();
     }
 }
 
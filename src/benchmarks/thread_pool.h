@@ -1,35 +1,330 @@
+#pragma once
+
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <condition_variable>
 #include <functional>
-#include <queue>
+#include <memory>
 #include <mutex>
+#include <span>
 #include <thread>
+#include <vector>
+
+#include "benchmarks/admission_control.h"
+#include "benchmarks/locks.h"
+#include "benchmarks/task.h"
+#include "benchmarks/thread_cpu_accounting.h"
 
 namespace blocking_to_async {
 namespace testing {
 
+struct ThreadPoolOptions {
+    enum class Scheduler {
+        // All workers pop from one mutex protected FIFO queue.
+        kSharedQueue,
+        // Every worker owns a Chase-Lev deque, idle workers steal from the others.
+        kWorkStealing,
+        // Shared queue with a thread count between bounds that follows the demand.
+        kElastic,
+    };
+
+    struct ElasticOptions {
+        int minThreads = 1;
+        // Zero means the concurrency passed to `ThreadPool::start()`.
+        int maxThreads = 0;
+        // Spawn threads when jobs have been waiting with all workers busy this long.
+        std::chrono::microseconds spawnAfterBusy{ 500 };
+        // Workers above the minimum retire after being idle this long.
+        std::chrono::milliseconds idleTimeout{ 200 };
+    };
+
+    // How a worker that found the queue empty waits for the next job.
+    struct IdleOptions {
+        // Polls the queue with `_mm_pause` for `spinFor`, then with `sched_yield` for
+        // `yieldFor`, before parking. Zeros park right away.
+        std::chrono::microseconds spinFor{ 0 };
+        std::chrono::microseconds yieldFor{ 0 };
+        // Workers polling at once, zero means half of the hardware threads. Idle workers
+        // beyond the bound park right away.
+        int maxSpinningWorkers = 0;
+    };
+
+    enum class Pinning {
+        // Workers float over all CPUs and share one pool.
+        kNone,
+        // One shard per physical core, its workers are pinned to the core's hyperthreads.
+        kPerCore,
+        // One shard per group of CPUs sharing the last level cache.
+        kPerLlc,
+        kPerNumaNode,
+    };
+
+    Scheduler scheduler = Scheduler::kSharedQueue;
+    // Jobs a worker takes per visit of the queue, capped to its share of the backlog.
+    // Jobs of a batch run one after another, only short non blocking jobs benefit.
+    int dequeueBatch = 1;
+    // A job queued by a worker of the pool goes into the worker's next job slot and runs
+    // on the same thread right after the current job, a job it displaces is queued.
+    bool lifoSlot = false;
+    // Anything but `kNone` splits the pool into per domain shards with their own queues,
+    // each shard uses `scheduler`.
+    Pinning pinning = Pinning::kNone;
+    // Only used by the `kElastic` scheduler.
+    ElasticOptions elastic;
+    // Only used by the `kSharedQueue` scheduler.
+    IdleOptions idle;
+    // Only used by the `kSharedQueue` scheduler, sharded pools apply it per shard.
+    AdmissionOptions admission;
+};
+
 class ThreadPool {
 public:
-    void start(int concurrency);
-    bool isWarm() const;
-    void queueJob(const std::function<void()>& job);
-    void stop();
-    int queueSize() const;
-    int currentlyRunning() const;
-    int spareCapacity() const;
+    virtual ~ThreadPool() = default;
+
+    static std::unique_ptr<ThreadPool> create(const ThreadPoolOptions& options);
+
+    virtual void start(int concurrency) = 0;
+    virtual bool isWarm() const = 0;
+    // Pools with admission control may shed a job instead of running it. A shed job is
+    // still invoked once, with `isShed()` true, on the thread that shed it and should
+    // only give up what it holds.
+    virtual void queueJob(Task&& job) = 0;
+    // Queues all `jobs`, moving from them, with one lock acquisition and wakeups sized
+    // to the batch where the pool supports it. Jobs of `JobPriority::kHigh` are taken
+    // before all queued jobs of normal priority, pools without priorities ignore it.
+    virtual void queueJobs(std::span<Task> jobs, JobPriority priority) {
+        for (auto& job : jobs) {
+            queueJob(std::move(job));
+        }
+    }
+    virtual void stop() = 0;
+    virtual int queueSize() const = 0;
+    virtual int currentlyRunning() const = 0;
+    virtual int spareCapacity() const = 0;
+
+    // Threads spawned and retired after `start()`, fixed size pools report zeros.
+    struct ThreadChurn {
+        int64_t spawned = 0;
+        int64_t retired = 0;
+    };
+
+    virtual ThreadChurn threadChurn() const {
+        return {};
+    }
+
+    // Wakeups of parked workers since `start()`. Spurious wakeups found no job left to
+    // take, `timeToWake` sums the delays from the wakeup request until the worker ran.
+    // `spinHits` counts the jobs idle workers found while polling, without parking.
+    struct WakeupStats {
+        int64_t wakeups = 0;
+        int64_t spuriousWakeups = 0;
+        std::chrono::nanoseconds timeToWake{ 0 };
+        int64_t spinHits = 0;
+
+        WakeupStats& operator+=(const WakeupStats& other);
+        WakeupStats& operator-=(const WakeupStats& other);
+    };
+
+    // Pools that do not park workers individually report zeros.
+    virtual WakeupStats wakeupStats() const {
+        return {};
+    }
+
+    // Pools without admission control report zeros.
+    virtual AdmissionStats admissionStats() const {
+        return {};
+    }
+
+    // True while the calling thread runs a job that was shed.
+    static bool isShed() {
+        return _shedding;
+    }
+
+    // Accounting of all threads the pool ever started.
+    virtual SchedStats schedStats() const {
+        return _threadAccounting.read();
+    }
+
+    // Shard of the calling thread when it is a worker of this pool, otherwise -1.
+    virtual int currentShard() const {
+        return -1;
+    }
+
+    // Queues `job` to `shard` as returned by `currentShard()`, pools without shards
+    // ignore the hint.
+    virtual void queueJobToShard(int shard, Task&& job) {
+        queueJob(std::move(job));
+    }
+
+    virtual void queueJobsToShard(int shard, std::span<Task> jobs, JobPriority priority) {
+        queueJobs(jobs, priority);
+    }
+
+    // Runs on every worker thread before it picks up jobs, must be set before `start()`.
+    void setThreadStartHook(std::function<void()> hook) {
+        _threadStartHook = std::move(hook);
+    }
+
+protected:
+    void _onThreadStart() {
+        _worker.pool = this;
+        _threadAccounting.addCurrentThread();
+        if (_threadStartHook) {
+            _threadStartHook();
+        }
+    }
+
+    // Releases a job left in the next job slot by a worker that stops.
+    void _onThreadExit();
+
+    // Puts `job` queued with `*priority` into the next job slot when the caller is a
+    // worker of this pool and the slot is enabled. Returns the job the caller still has
+    // to queue: `job` itself, the one displaced from the slot or null, and sets
+    // `*priority` to the priority it was queued with.
+    JobNode* _offerNextJob(JobNode* job, JobPriority* priority);
+
+    // Empties the next job slot of the calling worker, null when empty.
+    static JobNode* _takeNextJob();
+
+    // Runs the shed jobs of `jobs` with `isShed()` set and releases them.
+    static void _shed(JobQueue& jobs);
 
 private:
+    // Slot jobs in a row before the queue gets a turn again, bounds the starvation of
+    // queued jobs by a job chain that keeps queueing its successor.
+    static constexpr int kMaxNextJobStreak = 3;
+
+    struct Worker {
+        const ThreadPool* pool = nullptr;
+        JobNode* next = nullptr;
+        JobPriority nextPriority = JobPriority::kNormal;
+        int streak = 0;
+    };
+
+    bool _lifoSlot = false;
+    // Admission control only sees queued jobs, with it `JobPriority::kNormal` jobs skip
+    // the slot.
+    bool _lifoSlotTakesNormal = true;
+    std::function<void()> _threadStartHook;
+    ThreadCpuAccountingGroup _threadAccounting;
+
+    static thread_local Worker _worker;
+    static thread_local bool _shedding;
+};
+
+// Collects jobs queued by the calling thread while a `JobBatch::Scope` is alive and
+// queues them with one `queueJobsToShard()` call per pool and shard when the outermost
+// scope ends. Reactors open a scope around the callbacks of one wakeup.
+class JobBatch {
+public:
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // Queues through the batch of the current scope, or directly outside of scopes.
+    static void queue(ThreadPool* pool, int shard, std::span<Task> jobs,
+                      JobPriority priority = JobPriority::kNormal);
+
+private:
+    struct Group {
+        ThreadPool* pool;
+        int shard;
+        JobPriority priority;
+        std::vector<Task> jobs;
+    };
+
+    void _flush();
+
+    // Cleared groups keep their capacity, the steady state does not allocate.
+    std::vector<Group> _groups;
+    int _depth = 0;
+
+    static thread_local JobBatch _current;
+};
+
+// Idle workers poll the queue as configured by `ThreadPoolOptions::IdleOptions`, then
+// park on their own futex in a stack. A queued job wakes the most recently parked
+// worker, whose cache is the warmest, unless enough workers are already polling or on
+// their way to take the queued jobs. Jobs of normal priority pass the admission
+// controller when queued and, with a delay target, again when dequeued.
+class SharedQueueThreadPool : public ThreadPool {
+public:
+    explicit SharedQueueThreadPool(int dequeueBatch = 1,
+                                   const ThreadPoolOptions::IdleOptions& idle = {},
+                                   const AdmissionOptions& admission = {});
+
+    void start(int concurrency) override;
+    bool isWarm() const override;
+    void queueJob(Task&& job) override;
+    void queueJobs(std::span<Task> jobs, JobPriority priority) override;
+    void stop() override;
+    int queueSize() const override;
+    int currentlyRunning() const override;
+    int spareCapacity() const override;
+    WakeupStats wakeupStats() const override;
+    AdmissionStats admissionStats() const override;
+
+private:
+    struct alignas(64) IdleWorker {
+        Parker parker;
+        // Written by the waker before `Parker::unpark()`.
+        std::chrono::steady_clock::time_point wakeRequestedAt;
+    };
+
     void _threadLoop(int threadId);
 
+    // Parks the calling worker until a waker pops it from the idle stack, `lock` holds
+    // `_queueMutex` before and after.
+    void _park(IdleWorker* worker, std::unique_lock<std::mutex>& lock);
+
+    // Pops the top idle worker if the queued jobs outnumber the workers already woken
+    // or polling, must be called under `_queueMutex`. The caller unparks the returned
+    // worker.
+    IdleWorker* _popIdleWorker();
+
+    // Polls the queue within the spin and yield budgets, true once it has jobs.
+    bool _pollForJobs();
+
+    // Queues `node` unless the admission controller turns it down, must be called under
+    // `_queueMutex`. Jobs turned down or pushed out go to `shed`.
+    void _admit(JobNode* node, JobQueue* shed);
+
+    // `_admit()` for `JobPriority::kNormal`, a plain push for the priorities that bypass
+    // admission control. Must be called under `_queueMutex`.
+    void _queueNode(JobNode* node, JobPriority priority, JobQueue* shed);
+
+    const int _dequeueBatch;
+    const ThreadPoolOptions::IdleOptions _idle;
+    int _maxSpinningWorkers = 0;
     bool _shouldTerminate = false;           // Tells threads to stop looking for jobs
     mutable std::mutex _queueMutex;
     int _capacity;
-    std::condition_variable _mutexCondition; // Allows threads to wait on new jobs or termination 
     std::vector<std::thread> _threads;
-    std::queue<std::function<void()>> _jobs;
+    PriorityJobQueue _jobs;
+    // Guarded by `_queueMutex`.
+    AdmissionController _admission;
+    std::vector<std::unique_ptr<IdleWorker>> _workers;
+    // Guarded by `_queueMutex`. Parked workers, the most recently parked last, and
+    // workers popped from the stack that did not take the lock yet.
+    std::vector<IdleWorker*> _idleWorkers;
+    int _wakingWorkers = 0;
+    // Size of `_jobs` for polling workers, written under `_queueMutex`.
+    std::atomic<int> _queuedJobs{0};
+    std::atomic<int> _spinningWorkers{0};
     std::atomic<int> _currentlyRunning{0};
     std::atomic<int> _startedThreads{0};
+
+    std::atomic<int64_t> _wakeups{0};
+    std::atomic<int64_t> _spuriousWakeups{0};
+    std::atomic<int64_t> _timeToWakeNanos{0};
+    std::atomic<int64_t> _spinHits{0};
 };
 
 }  // namespace testing
-}  // namespace blocking_to_async 
+}  // namespace blocking_to_async
@@ -0,0 +1,239 @@
+#include "benchmarks/timer_reactor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "benchmarks/thread_pool.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+TimerWheel::~TimerWheel() {
+    auto release = [](Timer* timer) {
+        while (timer) {
+            auto next = timer->next;
+            delete timer;
+            timer = next;
+        }
+    };
+    for (auto& level : _slots) {
+        for (auto timer : level) {
+            release(timer);
+        }
+    }
+    release(_due);
+}
+
+void TimerWheel::add(Timer* timer) {
+    ++_size;
+    _insert(timer);
+}
+
+void TimerWheel::_insert(Timer* timer) {
+    if (timer->expiryTick <= _currentTick) {
+        timer->next = _due;
+        _due = timer;
+        return;
+    }
+    // Far away timers are clamped to the last tick of the current top level rotation,
+    // the expiry then differs from the current tick in the bits of the levels only.
+    static constexpr uint64_t kLevelMask = (uint64_t{1} << (kLevels * kSlotBits)) - 1;
+    timer->expiryTick = std::min(timer->expiryTick, _currentTick | kLevelMask);
+
+    uint64_t difference = timer->expiryTick ^ _currentTick;
+    int level = 0;
+    while (difference >= kSlots) {
+        difference >>= kSlotBits;
+        ++level;
+    }
+    auto& slot = _slots[level][(timer->expiryTick >> (level * kSlotBits)) & (kSlots - 1)];
+    timer->next = slot;
+    slot = timer;
+}
+
+void TimerWheel::advanceTo(uint64_t tick, std::vector<Timer*>* expired) {
+    auto collect = [this, expired](Timer* timer) {
+        while (timer) {
+            auto next = timer->next;
+            expired->push_back(timer);
+            --_size;
+            timer = next;
+        }
+    };
+    collect(_due);
+    _due = nullptr;
+
+    if (_size == 0) {
+        _currentTick = std::max(_currentTick, tick);
+        return;
+    }
+
+    while (_currentTick < tick) {
+        ++_currentTick;
+        // Find the highest level whose slot boundary was crossed and cascade top down,
+        // timers from a higher level may land in a lower level slot that is due now.
+        int topLevel = 0;
+        while (topLevel + 1 < kLevels &&
+               (_currentTick & ((uint64_t{1} << ((topLevel + 1) * kSlotBits)) - 1)) == 0) {
+            ++topLevel;
+        }
+        for (int level = topLevel; level >= 1; --level) {
+            auto& slot = _slots[level][(_currentTick >> (level * kSlotBits)) & (kSlots - 1)];
+            auto timer = slot;
+            slot = nullptr;
+            while (timer) {
+                auto next = timer->next;
+                _insert(timer);
+                timer = next;
+            }
+        }
+
+        auto& slot = _slots[0][_currentTick & (kSlots - 1)];
+        collect(slot);
+        slot = nullptr;
+        collect(_due);
+        _due = nullptr;
+    }
+}
+
+TimerReactor::~TimerReactor() {
+    stop();
+}
+
+void TimerReactor::start() {
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    _timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    _eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert(_epollFd >= 0 && _timerFd >= 0 && _eventFd >= 0);
+
+    for (int fd : { _timerFd, _eventFd }) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        int rc = epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event);
+        assert(rc == 0);
+    }
+    _shouldTerminate = false;
+    _thread = std::thread([this] { _threadLoop(); });
+}
+
+void TimerReactor::stop() {
+    if (!_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _shouldTerminate = true;
+    }
+    uint64_t one = 1;
+    auto written = write(_eventFd, &one, sizeof(one));
+    assert(written == sizeof(one));
+    _thread.join();
+
+    for (auto timer : _pending) {
+        delete timer;
+    }
+    _pending.clear();
+    for (int fd : { _epollFd, _timerFd, _eventFd }) {
+        close(fd);
+    }
+    _epollFd = _timerFd = _eventFd = -1;
+}
+
+void TimerReactor::schedule(Clock::time_point deadline, Task callback) {
+    // Round up, a timer never fires early.
+    auto timer = new TimerWheel::Timer{ _tickAt(deadline + kTick - Clock::duration(1)),
+                                        std::move(callback) };
+    bool shouldWake = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending.push_back(timer);
+        ++_scheduledTimers;
+        // A ticking reactor picks up pending timers on the next tick anyway.
+        shouldWake = !_ticking && _pending.size() == 1;
+    }
+    if (shouldWake) {
+        uint64_t one = 1;
+        auto written = write(_eventFd, &one, sizeof(one));
+        assert(written == sizeof(one));
+    }
+}
+
+int TimerReactor::pendingTimers() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _scheduledTimers;
+}
+
+uint64_t TimerReactor::_tickAt(Clock::time_point time) const {
+    if (time <= _epoch) {
+        return 0;
+    }
+    return (time - _epoch) / kTick;
+}
+
+void TimerReactor::_setTicking(bool ticking) {
+    itimerspec spec{};
+    if (ticking) {
+        spec.it_interval.tv_nsec = std::chrono::nanoseconds(kTick).count();
+        spec.it_value = spec.it_interval;
+    }
+    int rc = timerfd_settime(_timerFd, 0, &spec, nullptr);
+    assert(rc == 0);
+}
+
+void TimerReactor::_threadLoop() {
+    std::vector<TimerWheel::Timer*> pending;
+    std::vector<TimerWheel::Timer*> expired;
+
+    while (true) {
+        epoll_event events[2];
+        int count = epoll_wait(_epollFd, events, 2, -1);
+        for (int i = 0; i < count; ++i) {
+            uint64_t value;
+            // Both descriptors only need to be drained.
+            auto bytesRead = read(events[i].data.fd, &value, sizeof(value));
+            (void)bytesRead;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_shouldTerminate) {
+                break;
+            }
+            pending.swap(_pending);
+        }
+
+        _wheel.advanceTo(_tickAt(Clock::now()), &expired);
+        for (auto timer : pending) {
+            _wheel.add(timer);
+        }
+        pending.clear();
+        // Timers registered with a deadline in the past are due right away.
+        _wheel.advanceTo(_wheel.currentTick(), &expired);
+
+        {
+            // Jobs queued by the callbacks of one tick reach the pools together.
+            JobBatch::Scope batch;
+            for (auto timer : expired) {
+                timer->callback();
+                delete timer;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _scheduledTimers -= expired.size();
+        expired.clear();
+        bool shouldTick = _wheel.size() > 0 || !_pending.empty();
+        if (shouldTick != _ticking) {
+            _ticking = shouldTick;
+            _setTicking(shouldTick);
+        }
+    }
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "benchmarks/task.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+// Hierarchical timer wheel, not thread safe. Time is measured in ticks, each level has
+// 256 slots and covers 256 times more ticks than the level below. A timer is placed
+// at the level of the highest 8 bit group where its expiry differs from the current
+// tick and cascades down when the current tick reaches its slot.
+class TimerWheel {
+public:
+    struct Timer {
+        uint64_t expiryTick;
+        Task callback;
+        Timer* next = nullptr;
+    };
+
+    ~TimerWheel();
+
+    uint64_t currentTick() const {
+        return _currentTick;
+    }
+
+    int size() const {
+        return _size;
+    }
+
+    // Takes ownership. Timers that are already due go to the expired list.
+    void add(Timer* timer);
+
+    // Moves the wheel forward to `tick` and appends all expired timers to `expired`,
+    // the caller owns them.
+    void advanceTo(uint64_t tick, std::vector<Timer*>* expired);
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 8;
+    static constexpr int kSlots = 1 << kSlotBits;
+
+    void _insert(Timer* timer);
+
+    uint64_t _currentTick = 0;
+    int _size = 0;
+    std::array<std::array<Timer*, kSlots>, kLevels> _slots{};
+    Timer* _due = nullptr;
+};
+
+// One thread that runs callbacks when their deadlines expire. Replaces a thread parked
+// per blocking call with one timer per blocking call. The thread waits in `epoll`
+// on a `timerfd` that ticks while any timer is pending and on an `eventfd` that
+// signals new timers while the wheel is idle.
+class TimerReactor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Resolution of the wheel.
+    static constexpr std::chrono::microseconds kTick{50};
+
+    ~TimerReactor();
+
+    void start();
+
+    // Pending timers are discarded.
+    void stop();
+
+    // Thread safe. The callback runs on the reactor thread, it should only hand off
+    // work to some other thread.
+    void schedule(Clock::time_point deadline, Task callback);
+
+    int pendingTimers() const;
+
+private:
+    void _threadLoop();
+
+    uint64_t _tickAt(Clock::time_point time) const;
+
+    void _setTicking(bool ticking);
+
+    const Clock::time_point _epoch = Clock::now();
+    int _epollFd = -1;
+    int _timerFd = -1;
+    int _eventFd = -1;
+    std::thread _thread;
+
+    mutable std::mutex _mutex;
+    // Timers scheduled since the last time the reactor woke up.
+    std::vector<TimerWheel::Timer*> _pending;
+    bool _ticking = false;
+    bool _shouldTerminate = false;
+    int _scheduledTimers = 0;
+
+    // Only accessed by the reactor thread.
+    TimerWheel _wheel;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
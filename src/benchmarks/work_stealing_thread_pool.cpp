@@ -0,0 +1,272 @@
+#include "benchmarks/work_stealing_thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace blocking_to_async {
+namespace testing {
+
+thread_local WorkStealingThreadPool* WorkStealingThreadPool::_currentPool = nullptr;
+thread_local int WorkStealingThreadPool::_currentWorker = -1;
+
+WorkStealingThreadPool::WorkDeque::Array::Array(int64_t capacity)
+    : capacity(capacity),
+      slots(new std::atomic<Job*>[capacity]) {
+    assert((capacity & (capacity - 1)) == 0);
+}
+
+WorkStealingThreadPool::WorkDeque::WorkDeque()
+    : _array(new Array(kInitialCapacity)) {
+}
+
+WorkStealingThreadPool::WorkDeque::~WorkDeque() {
+    delete _array.load();
+}
+
+void WorkStealingThreadPool::WorkDeque::push(Job* job) {
+    int64_t b = _bottom.load(std::memory_order_relaxed);
+    int64_t t = _top.load(std::memory_order_acquire);
+    Array* a = _array.load(std::memory_order_relaxed);
+    if (b - t > a->capacity - 1) {
+        auto grown = new Array(a->capacity * 2);
+        for (int64_t i = t; i < b; ++i) {
+            grown->put(i, a->get(i));
+        }
+        _retired.emplace_back(a);
+        _array.store(grown, std::memory_order_release);
+        a = grown;
+    }
+    a->put(b, job);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+WorkStealingThreadPool::Job* WorkStealingThreadPool::WorkDeque::pop() {
+    int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+    Array* a = _array.load(std::memory_order_relaxed);
+    _bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = _top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        // Empty.
+        _bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job* job = a->get(b);
+    if (t == b) {
+        // Last element, race against thieves.
+        if (!_top.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        _bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+WorkStealingThreadPool::Job* WorkStealingThreadPool::WorkDeque::steal() {
+    int64_t t = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = _bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+        return nullptr;
+    }
+    Array* a = _array.load(std::memory_order_acquire);
+    Job* job = a->get(t);
+    if (!_top.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;  // Lost the race to the owner or another thief.
+    }
+    return job;
+}
+
+WorkStealingThreadPool::WorkStealingThreadPool(int dequeueBatch)
+    : _dequeueBatch(std::max(1, dequeueBatch)) {}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+    stop();
+    // Release the jobs that never ran.
+    for (auto& worker : _workers) {
+        while (auto job = worker->deque.steal()) {
+            JobNode::release(job);
+        }
+    }
+}
+
+void WorkStealingThreadPool::start(int concurrency) {
+    assert(concurrency >= 1);
+    _capacity = concurrency;
+    _shouldTerminate = false;
+    for (int i = 0; i < concurrency; ++i) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    // All workers must exist before any thread starts stealing.
+    for (int i = 0; i < concurrency; ++i) {
+        _threads.emplace_back([this, i] { _threadLoop(i); });
+    }
+}
+
+bool WorkStealingThreadPool::isWarm() const {
+    return _startedThreads == _capacity;
+}
+
+void WorkStealingThreadPool::queueJob(Task&& job) {
+    auto priority = JobPriority::kNormal;
+    auto queued = _offerNextJob(JobNode::allocate(std::move(job)), &priority);
+    if (!queued) {
+        return;
+    }
+    if (_currentPool == this) {
+        // Lock free push into own deque.
+        _workers[_currentWorker]->deque.push(queued);
+    } else {
+        auto& worker = *_workers[_nextInbox.fetch_add(1, std::memory_order_relaxed) % _capacity];
+        std::lock_guard<std::mutex> lock(worker.inboxMutex);
+        worker.inbox.push(queued, priority);
+    }
+    _onJobQueued();
+}
+
+void WorkStealingThreadPool::queueJobs(std::span<Task> jobs, JobPriority priority) {
+    int queued = 0;
+    if (_currentPool == this) {
+        // The owner pops its deque LIFO, local jobs do not need a priority.
+        auto& deque = _workers[_currentWorker]->deque;
+        for (auto& job : jobs) {
+            auto nodePriority = priority;
+            if (auto node = _offerNextJob(JobNode::allocate(std::move(job)), &nodePriority)) {
+                deque.push(node);
+                ++queued;
+            }
+        }
+    } else {
+        JobQueue batch;
+        for (auto& job : jobs) {
+            batch.push(JobNode::allocate(std::move(job)));
+        }
+        queued = batch.size();
+        auto& worker = *_workers[_nextInbox.fetch_add(1, std::memory_order_relaxed) % _capacity];
+        std::lock_guard<std::mutex> lock(worker.inboxMutex);
+        worker.inbox.splice(batch, priority);
+    }
+    if (queued > 0) {
+        _onJobQueued(queued);
+    }
+}
+
+void WorkStealingThreadPool::_onJobQueued(int count) {
+    // Pairs with the increment of `_parkedThreads` in `_threadLoop()`: either the parking
+    // worker observes the new job or this thread observes the parked worker.
+    _queuedJobs.fetch_add(count, std::memory_order_seq_cst);
+    int parked = _parkedThreads.load(std::memory_order_seq_cst);
+    if (parked > 0) {
+        { std::lock_guard<std::mutex> lock(_parkMutex); }
+        for (int i = std::min(count, parked); i > 0; --i) {
+            _parkCondition.notify_one();
+        }
+    }
+}
+
+void WorkStealingThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_parkMutex);
+        _shouldTerminate = true;
+    }
+    _parkCondition.notify_all();
+    for (std::thread& active_thread : _threads) {
+        active_thread.join();
+    }
+    _threads.clear();
+}
+
+int WorkStealingThreadPool::queueSize() const {
+    return _queuedJobs;
+}
+
+int WorkStealingThreadPool::currentlyRunning() const {
+    return _currentlyRunning;
+}
+
+int WorkStealingThreadPool::spareCapacity() const {
+    return _capacity - _currentlyRunning;
+}
+
+WorkStealingThreadPool::Job* WorkStealingThreadPool::_findJob(int threadId, uint64_t& random) {
+    auto& self = *_workers[threadId];
+    if (auto job = self.deque.pop()) {
+        return job;
+    }
+    {
+        std::lock_guard<std::mutex> lock(self.inboxMutex);
+        if (auto job = self.inbox.pop()) {
+            // The rest of the batch stays stealable in the own deque.
+            for (int i = 1; i < _dequeueBatch && !self.inbox.empty(); ++i) {
+                self.deque.push(self.inbox.pop());
+            }
+            return job;
+        }
+    }
+
+    // Visit every victim once, starting at a random one to spread the thieves.
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    for (int i = 0; i < _capacity; ++i) {
+        int victimId = (random + i) % _capacity;
+        if (victimId == threadId) {
+            continue;
+        }
+        auto& victim = *_workers[victimId];
+        if (auto job = victim.deque.steal()) {
+            return job;
+        }
+        std::unique_lock<std::mutex> lock(victim.inboxMutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+            if (auto job = victim.inbox.pop()) {
+                return job;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void WorkStealingThreadPool::_threadLoop(int threadId) {
+    _currentPool = this;
+    _currentWorker = threadId;
+    _onThreadStart();
+    uint64_t random = 0x9E3779B97F4A7C15ull * (threadId + 1);
+    ++_startedThreads;
+
+    while (!_shouldTerminate.load(std::memory_order_relaxed)) {
+        if (auto next = _takeNextJob()) {
+            // Never counted in `_queuedJobs`.
+            ++_currentlyRunning;
+            next->task();
+            --_currentlyRunning;
+            JobNode::release(next);
+            continue;
+        }
+        Job* job = _findJob(threadId, random);
+        if (!job) {
+            std::unique_lock<std::mutex> lock(_parkMutex);
+            _parkedThreads.fetch_add(1, std::memory_order_seq_cst);
+            _parkCondition.wait(lock, [this] {
+                return _queuedJobs.load(std::memory_order_seq_cst) > 0 || _shouldTerminate;
+            });
+            _parkedThreads.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+        _queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        ++_currentlyRunning;
+        job->task();
+        --_currentlyRunning;
+        JobNode::release(job);
+    }
+    _onThreadExit();
+    _currentPool = nullptr;
+    _currentWorker = -1;
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "benchmarks/thread_pool.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+// Thread pool without a shared queue. Jobs queued by a worker of this pool go into
+// the worker's own Chase-Lev deque without taking any lock. Jobs queued from outside
+// threads are spread round robin over per-worker inboxes. Idle workers steal from
+// the other workers' deques and inboxes before parking.
+class WorkStealingThreadPool : public ThreadPool {
+public:
+    // A worker drains up to `dequeueBatch` jobs from its inbox at once into its deque,
+    // where they stay available to thieves.
+    explicit WorkStealingThreadPool(int dequeueBatch = 1);
+    ~WorkStealingThreadPool() override;
+
+    void start(int concurrency) override;
+    bool isWarm() const override;
+    void queueJob(Task&& job) override;
+    // Batches queued from outside go into a single inbox.
+    void queueJobs(std::span<Task> jobs, JobPriority priority) override;
+    void stop() override;
+    int queueSize() const override;
+    int currentlyRunning() const override;
+    int spareCapacity() const override;
+
+private:
+    using Job = JobNode;
+
+    // Chase-Lev deque ("Correct and Efficient Work-Stealing for Weak Memory Models",
+    // Le et al. 2013). Only the owner calls push() and pop(), any thread may steal().
+    class WorkDeque {
+    public:
+        WorkDeque();
+        ~WorkDeque();
+
+        void push(Job* job);
+        Job* pop();
+        Job* steal();
+
+    private:
+        struct Array {
+            explicit Array(int64_t capacity);
+
+            Job* get(int64_t i) const {
+                return slots[i & (capacity - 1)].load(std::memory_order_relaxed);
+            }
+
+            void put(int64_t i, Job* job) {
+                slots[i & (capacity - 1)].store(job, std::memory_order_relaxed);
+            }
+
+            const int64_t capacity;
+            std::unique_ptr<std::atomic<Job*>[]> slots;
+        };
+
+        static constexpr int64_t kInitialCapacity = 256;
+
+        alignas(64) std::atomic<int64_t> _top{0};
+        alignas(64) std::atomic<int64_t> _bottom{0};
+        std::atomic<Array*> _array;
+        // Arrays replaced by growth may still be read by a concurrent thief,
+        // they are only released with the deque.
+        std::vector<std::unique_ptr<Array>> _retired;
+    };
+
+    struct alignas(64) Worker {
+        WorkDeque deque;
+        // Jobs queued from threads outside of the pool.
+        std::mutex inboxMutex;
+        PriorityJobQueue inbox;
+    };
+
+    void _threadLoop(int threadId);
+
+    Job* _findJob(int threadId, uint64_t& random);
+
+    // Called after `count` jobs became visible to the workers.
+    void _onJobQueued(int count = 1);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::thread> _threads;
+    int _capacity = 0;
+    const int _dequeueBatch;
+    std::atomic<bool> _shouldTerminate{false};
+    std::atomic<uint32_t> _nextInbox{0};
+
+    alignas(64) std::atomic<int> _queuedJobs{0};
+    alignas(64) std::atomic<int> _currentlyRunning{0};
+    std::atomic<int> _startedThreads{0};
+
+    // Idle workers park here once there is nothing left to steal.
+    std::mutex _parkMutex;
+    std::condition_variable _parkCondition;
+    std::atomic<int> _parkedThreads{0};
+
+    // Set for the pool worker threads, used to detect local pushes.
+    static thread_local WorkStealingThreadPool* _currentPool;
+    static thread_local int _currentWorker;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -9,9 +9,11 @@
 #include <cassert>
 #include <filesystem>
 #include <fstream>
+#include <malloc.h>
 #include <random>
 #include <sstream>
 #include <string.h>
+#include <sys/prctl.h>
 #include <x86intrin.h>
 #include <unistd.h>
 
@@ -42,12 +44,22 @@ void Stats::appendConcurrent(const Stats& other) {
 
     iterations += other.iterations * duration / other.duration;
     threadMigrations += other.threadMigrations;
+    threadsSpawned += other.threadsSpawned;
+    threadsRetired += other.threadsRetired;
+    wakeups += other.wakeups;
+    admission += other.admission;
+    perf += other.perf;
 }
 
 void Stats::append(const Stats& other) {
     duration += other.duration;
     iterations += other.iterations;
     threadMigrations += other.threadMigrations;
+    threadsSpawned += other.threadsSpawned;
+    threadsRetired += other.threadsRetired;
+    wakeups += other.wakeups;
+    admission += other.admission;
+    perf += other.perf;
 }
 
 Stats Stats::diff(const Stats& other) const {
@@ -57,6 +69,14 @@ Stats Stats::diff(const Stats& other) const {
     result.threadMigrations = threadMigrations - other.threadMigrations;
     result.minflt = minflt - other.minflt;
     result.majflt = majflt - other.majflt;
+    result.threadsSpawned = threadsSpawned - other.threadsSpawned;
+    result.threadsRetired = threadsRetired - other.threadsRetired;
+    result.wakeups = wakeups;
+    result.wakeups -= other.wakeups;
+    result.admission = admission;
+    result.admission -= other.admission;
+    result.perf = perf;
+    result.perf -= other.perf;
     return result;
 }
 
@@ -77,6 +97,24 @@ std::tuple<int, int> Stats::getPageFaults() {
     return { minflt, majflt };
 }
 
+std::tuple<size_t, size_t> Stats::getMemoryUsage() {
+    auto info = mallinfo2();
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, residentPages = 0;
+    statm >> pages >> residentPages;
+    return { info.uordblks + info.hblkhd, residentPages * sysconf(_SC_PAGESIZE) };
+}
+
+std::chrono::microseconds timeToBlock(
+    std::chrono::high_resolution_clock::duration timeActive, double ratioOfTimeToBlock) {
+    static thread_local std::mt19937 gen;
+    auto timeToSleep = 1 / (1 - ratioOfTimeToBlock) * timeActive - timeActive;
+    std::uniform_int_distribution<std::mt19937::result_type> distrib(
+        0, std::chrono::duration_cast<std::chrono::microseconds>(timeToSleep / 40).count());
+    return std::chrono::duration_cast<std::chrono::microseconds>(timeToSleep) +
+        std::chrono::microseconds(distrib(gen));
+}
+
 MultithreadedWorkload::MultithreadedWorkload(
     std::function<std::unique_ptr<Workload>()> createCallback)
     : _createCallback(createCallback) {
@@ -117,6 +155,19 @@ void MultithreadedWorkload::scaleNonBlockingWorkloadTo(int newThreadCount) {
     }
 }
 
+void MultithreadedWorkload::setBlockingCall(const BlockingCallOptions& options) {
+    if (options.kind == BlockingCallOptions::Kind::kSleep) {
+        _dataFile.reset();
+    } else if (!_dataFile || !(options == _blockingCall)) {
+        // Running workloads keep the previous file alive.
+        _dataFile = std::make_shared<DataFile>(options.diskRead);
+    } else {
+        // Reads of the previous run cached part of the file.
+        _dataFile->evictFromPageCache();
+    }
+    _blockingCall = options;
+}
+
 void MultithreadedWorkload::resetBlockingWorkflowTo(int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep) {
     assert(threadCount >= 0);
 
@@ -129,6 +180,7 @@ void MultithreadedWorkload::resetBlockingWorkflowTo(int threadCount, double rati
         assert(workload);
         auto threadWorkload = std::make_unique<ThreadPartiallyBlockedWorkload>(
             std::move(workload), ratioOfTimeToBlock, iterationsBeforeSleep);
+        threadWorkload->setDataFile(_dataFile);
         threadWorkload->start();
         _workloads.push_back(std::move(threadWorkload));
     }
@@ -136,11 +188,53 @@ void MultithreadedWorkload::resetBlockingWorkflowTo(int threadCount, double rati
 }
 
 void MultithreadedWorkload::startPooledWorkload(
-    int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep) {
+    int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+    const PooledWorkloadConfig& poolConfig) {
     auto workload = _createCallback();
     assert(workload);
     auto threadWorkload = std::make_unique<ThreadPoolWorkload>(
-        std::move(workload), ratioOfTimeToBlock, iterationsBeforeSleep, threadCount);
+        std::move(workload), ratioOfTimeToBlock, iterationsBeforeSleep, threadCount, poolConfig);
+    threadWorkload->setDataFile(_dataFile);
+    threadWorkload->start();
+    _workloads.push_back(std::move(threadWorkload));
+    std::cerr << "Workloads size " << _workloads.size() << std::endl;
+}
+
+void MultithreadedWorkload::startCoroutineWorkload(
+    int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+    int concurrentRequests, const ThreadPoolOptions& poolOptions) {
+    auto workload = _createCallback();
+    assert(workload);
+    auto threadWorkload = std::make_unique<ThreadCoroutineWorkload>(
+        std::move(workload), ratioOfTimeToBlock, iterationsBeforeSleep, threadCount,
+        concurrentRequests, poolOptions);
+    threadWorkload->start();
+    _workloads.push_back(std::move(threadWorkload));
+    std::cerr << "Workloads size " << _workloads.size() << std::endl;
+}
+
+void MultithreadedWorkload::startFiberWorkload(
+    int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+    int concurrentRequests, const FiberWorkloadConfig& fiberConfig) {
+    auto workload = _createCallback();
+    assert(workload);
+    auto threadWorkload = std::make_unique<ThreadFiberWorkload>(
+        std::move(workload), ratioOfTimeToBlock, iterationsBeforeSleep, threadCount,
+        concurrentRequests, fiberConfig);
+    threadWorkload->setDataFile(_dataFile);
+    threadWorkload->start();
+    _workloads.push_back(std::move(threadWorkload));
+    std::cerr << "Workloads size " << _workloads.size() << std::endl;
+}
+
+void MultithreadedWorkload::startOpenLoopWorkload(
+    int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+    const OpenLoopOptions& options) {
+    auto workload = _createCallback();
+    assert(workload);
+    auto threadWorkload = std::make_unique<ThreadOpenLoopWorkload>(
+        std::move(workload), ratioOfTimeToBlock, iterationsBeforeSleep, threadCount, options);
+    threadWorkload->setDataFile(_dataFile);
     threadWorkload->start();
     _workloads.push_back(std::move(threadWorkload));
     std::cerr << "Workloads size " << _workloads.size() << std::endl;
@@ -148,6 +242,9 @@ void MultithreadedWorkload::startPooledWorkload(
 
 void MultithreadedWorkload::stopPooledWorkload() {
     _removeExtraWorkloadsByType(0, ThreadWorkload::WorkloadType::kBlockingPooled);
+    _removeExtraWorkloadsByType(0, ThreadWorkload::WorkloadType::kBlockingCoroutine);
+    _removeExtraWorkloadsByType(0, ThreadWorkload::WorkloadType::kBlockingFiber);
+    _removeExtraWorkloadsByType(0, ThreadWorkload::WorkloadType::kOpenLoop);
 }
 
 void MultithreadedWorkload::resetStats() {
@@ -166,6 +263,30 @@ Stats MultithreadedWorkload::getStats() const {
     return result;
 }
 
+RequestLatencies MultithreadedWorkload::getLatencies() const {
+    RequestLatencies result;
+    for (const auto& w : _workloads) {
+        result.merge(w->getLatencies());
+    }
+    return result;
+}
+
+std::map<std::string, SchedStats> MultithreadedWorkload::getSchedStats() const {
+    std::map<std::string, SchedStats> result;
+    for (const auto& w : _workloads) {
+        w->appendSchedStats(&result);
+    }
+    return result;
+}
+
+OpenLoopStats MultithreadedWorkload::getOpenLoopStats() const {
+    OpenLoopStats result;
+    for (const auto& w : _workloads) {
+        w->appendOpenLoopStats(&result);
+    }
+    return result;
+}
+
 std::string MultithreadedWorkload::status() const {
     if (!_workloads.empty()) {
         return _workloads[0]->status();
@@ -186,6 +307,7 @@ MultithreadedWorkload::ThreadWorkload::~ThreadWorkload() {
 
 void MultithreadedWorkload::ThreadWorkload::start() {
     _thread = std::make_unique<std::thread>([this] {
+        _threadAccounting.addCurrentThread();
         Stats localStats;
         auto start = std::chrono::high_resolution_clock::now();
 
@@ -199,13 +321,28 @@ void MultithreadedWorkload::ThreadWorkload::start() {
             localStats.duration =
                 std::chrono::duration_cast<std::chrono::microseconds>(now - start);
             start = now;
-            std::lock_guard<std::mutex> guard(_mutex);
-            _stats.append(localStats);
+            _stats.add(localStats.iterations, localStats.threadMigrations, localStats.duration);
             localStats = Stats();  // Reset for new cycle.
         }
     });
 }
 
+Stats MultithreadedWorkload::ThreadWorkload::getStats() const {
+    auto counters = _stats.counters();
+    Stats stats;
+    stats.duration = counters.duration;
+    stats.iterations = counters.iterations;
+    stats.threadMigrations = counters.threadMigrations;
+    stats.perf = counters.perf;
+    return stats;
+}
+
+void MultithreadedWorkload::ThreadWorkload::appendSchedStats(
+    std::map<std::string, SchedStats>* byName) const {
+    auto name = workloadType() == WorkloadType::kNonBlocking ? "nonBlocking" : "blocking";
+    (*byName)[name] += _threadAccounting.read();
+}
+
 void MultithreadedWorkload::ThreadWorkload::terminate() {
     _terminate = true;
     if (_thread) {
@@ -222,7 +359,7 @@ unsigned MultithreadedWorkload::ThreadWorkload::getCoreId() {
 
 void MultithreadedWorkload::ThreadWorkload::_sleep(std::chrono::microseconds sleepFor) {
     const auto startCoreId = getCoreId();
-    std::unique_lock<std::mutex> guard(_mutex);
+    std::unique_lock<std::mutex> guard(_sleepMutex);
     while (startCoreId + 1 > _perCoreSleepCv.size()) {
         _perCoreSleepCv.emplace_back(new std::condition_variable);
     }
@@ -242,6 +379,14 @@ void MultithreadedWorkload::ThreadWorkload::_sleep(std::chrono::microseconds sle
     });
 }
 
+void MultithreadedWorkload::ThreadWorkload::_blockingCall(std::chrono::microseconds blockFor) {
+    if (_dataFile) {
+        _dataFile->blockingRead();
+    } else {
+        _sleep(blockFor);
+    }
+}
+
 
 MultithreadedWorkload::ThreadPartiallyBlockedWorkload::ThreadPartiallyBlockedWorkload(
     std::unique_ptr<Workload> workload, double ratioOfTimeToBlock, int iterationsBeforeSleep)
@@ -253,6 +398,7 @@ MultithreadedWorkload::ThreadPartiallyBlockedWorkload::ThreadPartiallyBlockedWor
 
 void MultithreadedWorkload::ThreadPartiallyBlockedWorkload::start() {
     _thread = std::make_unique<std::thread>([this] {
+        _threadAccounting.addCurrentThread();
         Stats localStats;
         auto iterationStart = std::chrono::high_resolution_clock::now();
         int threadMigrations = 0;
@@ -269,24 +415,22 @@ void MultithreadedWorkload::ThreadPartiallyBlockedWorkload::start() {
                 std::chrono::duration_cast<std::chrono::microseconds>(now - iterationStart);
 
             // Sleep.
-            static thread_local std::mt19937 gen;
-            auto timeActive = now - iterationStart;
-            auto timeToSleep = 1 / (1 - _ratioOfTimeToBlock) * timeActive - timeActive;
-            std::uniform_int_distribution<std::mt19937::result_type> distrib(
-                0, std::chrono::duration_cast<std::chrono::microseconds>(timeToSleep / 40).count());
-            _sleep(std::chrono::duration_cast<std::chrono::microseconds>(timeToSleep) + 
-                   std::chrono::microseconds(distrib(gen)));
+            auto blockStart = now;
+            _blockingCall(timeToBlock(now - iterationStart, _ratioOfTimeToBlock));
 
             // Adjust stats
             now = std::chrono::high_resolution_clock::now();
-            std::lock_guard<std::mutex> guard(_mutex);
+            _stats.recordLatencies([&](RequestLatencies& latencies) {
+                latencies.compute.record(blockStart - iterationStart);
+                latencies.block.record(now - blockStart);
+                latencies.endToEnd.record(now - iterationStart);
+            });
             localStats.duration = std::chrono::duration_cast<std::chrono::microseconds>(
                 now - iterationStart);
-            _stats.append(localStats);
-            _stats.threadMigrations = threadMigrations;
             if (previousCoreId != getCoreId()) {
-                ++_stats.threadMigrations;
+                ++threadMigrations;
             }
+            _stats.add(localStats.iterations, threadMigrations, localStats.duration);
             threadMigrations = 0;
             localStats = Stats();  // Reset for new cycle.
             iterationStart = now;
@@ -296,44 +440,86 @@ void MultithreadedWorkload::ThreadPartiallyBlockedWorkload::start() {
 
 MultithreadedWorkload::ThreadPoolWorkload::ThreadPoolWorkload(
     std::unique_ptr<Workload> workload, double ratioOfTimeToBlock, 
-    int iterationsBeforeSleep, int threadCount)
+    int iterationsBeforeSleep, int threadCount, const PooledWorkloadConfig& poolConfig)
     : ThreadWorkload(std::move(workload)),
       _ratioOfTimeToBlock(ratioOfTimeToBlock),
       _iterationsBeforeSleep(iterationsBeforeSleep),
-      _threadCount(threadCount) {
+      _threadCount(threadCount),
+      _poolConfig(poolConfig),
+      _unblockedWorkloadThreadPool(ThreadPool::create(poolConfig.unblockedPool)),
+      _blockingCallsThreadPool(ThreadPool::create(poolConfig.blockingPool)) {
         assert(_iterationsBeforeSleep >= 1);
         assert(threadCount >= 1);
 }
 
 MultithreadedWorkload::ThreadPoolWorkload::~ThreadPoolWorkload() {
-    _unblockedWorkloadThreadPool.stop();
-    _blockingCallsThreadPool.stop();
+    _unblockedWorkloadThreadPool->stop();
+    _blockingCallsThreadPool->stop();
+    _timerReactor.stop();
+    _ioUringReactor.stop();
 }
 
 void MultithreadedWorkload::ThreadPoolWorkload::start() {
     // Unlike workloads below the pooled workload has only one instance.
-    _unblockedWorkloadThreadPool.start(_threadCount);
-    _blockingCallsThreadPool.start(std::min(_threadCount * 20, 800));
+    _unblockedWorkloadThreadPool->start(_threadCount);
+    switch (_poolConfig.blockingBackend) {
+    case PooledWorkloadConfig::BlockingBackend::kThreadPool:
+        _blockingCallsThreadPool->start(std::min(_threadCount * 20, 800));
+        break;
+    case PooledWorkloadConfig::BlockingBackend::kTimerReactor:
+        _timerReactor.start();
+        break;
+    case PooledWorkloadConfig::BlockingBackend::kIoUring:
+        _ioUringReactor.start(_poolConfig.ioUring);
+        break;
+    }
     // Let threads start.
-    while (!_unblockedWorkloadThreadPool.isWarm() || !_blockingCallsThreadPool.isWarm()) {
+    while (!_unblockedWorkloadThreadPool->isWarm() ||
+           (_usesBlockingThreadPool() && !_blockingCallsThreadPool->isWarm())) {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
+    if (_poolConfig.connections > 0) {
+        // Every connection sends its first request at once.
+        _connections.resize(_poolConfig.connections);
+        for (auto& connection : _connections) {
+            Task job = unblockedWorkloadThreadPoolJob(&connection);
+            _unblockedWorkloadThreadPool->queueJobs({ &job, 1 }, _connectionPriority());
+        }
+        return;
+    }
     for (int i = 0; i <= _threadCount; ++i) {
-        _unblockedWorkloadThreadPool.queueJob(unblockedWorkloadThreadPoolJob());
+        _unblockedWorkloadThreadPool->queueJob(unblockedWorkloadThreadPoolJob());
     }
 }
 
-std::function<void()> MultithreadedWorkload::ThreadPoolWorkload::unblockedWorkloadThreadPoolJob() {
-    return [this] {
+Task MultithreadedWorkload::ThreadPoolWorkload::unblockedWorkloadThreadPoolJob(
+    Connection* connection) {
+    return _computeStageJob(connection, std::chrono::steady_clock::now(), 0);
+}
+
+Task MultithreadedWorkload::ThreadPoolWorkload::_computeStageJob(
+    Connection* connection, std::chrono::steady_clock::time_point requestQueuedAt, int stage) {
+    auto queuedAt = std::chrono::steady_clock::now();
+    return [this, requestQueuedAt, queuedAt, connection, stage] {
         Stats localStats;
         auto iterationStart = std::chrono::high_resolution_clock::now();
+        auto computeStart = std::chrono::steady_clock::now();
         int threadMigrations = 0;
 
+        if (ThreadPool::isShed()) {
+            return;
+        }
         if (_terminate.load(std::memory_order_relaxed)) {
-            _unblockedWorkloadThreadPool.stop();
+            _unblockedWorkloadThreadPool->stop();
             return;
         }
 
+        if (connection && stage == 0) {
+            ++connection->requests;
+            connection->lastRequestAt = computeStart;
+            connection->session[connection->requests % connection->session.size()] ^=
+                connection->requests;
+        }
         while (true) {
             threadMigrations += _workload->unitOfWork();
             if (++localStats.iterations >= _iterationsBeforeSleep) {
@@ -345,43 +531,707 @@ std::function<void()> MultithreadedWorkload::ThreadPoolWorkload::unblockedWorklo
         auto duration =
             std::chrono::duration_cast<std::chrono::microseconds>(now - iterationStart);
 
-        // Calculate sleep time.
-        static thread_local std::mt19937 gen;
-        auto timeActive = now - iterationStart;
-        auto timeToSleep = 1 / (1 - _ratioOfTimeToBlock) * timeActive - timeActive;
-        std::uniform_int_distribution<std::mt19937::result_type> distrib(
-            0, std::chrono::duration_cast<std::chrono::microseconds>(timeToSleep / 40).count());
-        timeToSleep += std::chrono::microseconds(distrib(gen));
+        // Calculate sleep time, the stages of a request take about the same time.
+        auto timeToSleep = timeToBlock(
+            (now - iterationStart) * (_poolConfig.computeStages + 1), _ratioOfTimeToBlock);
+        auto computeEnd = std::chrono::steady_clock::now();
 
         // Adjust stats
-        {
-            std::lock_guard<std::mutex> guard(_mutex);
-            _stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(now - _measurementsStart);
-            _stats.iterations += localStats.iterations;
-            _stats.threadMigrations += threadMigrations;
+        _stats.add(localStats.iterations, threadMigrations);
+        _stats.recordLatencies([&](RequestLatencies& latencies) {
+            latencies.computeQueueWait.record(computeStart - queuedAt);
+            latencies.compute.record(computeEnd - computeStart);
+        });
+
+        // Continuations return to the shard that issued the blocking call so that the
+        // follow up work keeps running on the same CPUs.
+        int shard = _unblockedWorkloadThreadPool->currentShard();
+        if (stage + 1 < _poolConfig.computeStages) {
+            // Queued by the worker itself, the next job slot can take it.
+            _unblockedWorkloadThreadPool->queueJobToShard(
+                shard, _computeStageJob(connection, requestQueuedAt, stage + 1));
+            return;
         }
+        switch (_poolConfig.blockingBackend) {
+        case PooledWorkloadConfig::BlockingBackend::kThreadPool:
+            _blockingCallsThreadPool->queueJobToShard(
+                shard, [this, timeToSleep, shard, requestQueuedAt, computeEnd, connection] {
+                    if (ThreadPool::isShed()) {
+                        return;
+                    }
+                    auto blockStart = std::chrono::steady_clock::now();
+                    _blockingCall(timeToSleep);
+                    _recordBlockingLeg(computeEnd, blockStart);
+                    _onBlockingCallDone(shard, connection, requestQueuedAt);
+                });
+            break;
+        case PooledWorkloadConfig::BlockingBackend::kTimerReactor:
+            // The continuation runs on the reactor thread and only queues new jobs.
+            _timerReactor.schedule(
+                TimerReactor::Clock::now() + timeToSleep,
+                [this, shard, requestQueuedAt, computeEnd, connection] {
+                    _recordBlockingLeg(computeEnd, computeEnd);
+                    _onBlockingCallDone(shard, connection, requestQueuedAt);
+                });
+            break;
+        case PooledWorkloadConfig::BlockingBackend::kIoUring: {
+            auto onCompletion = [this, shard, requestQueuedAt, computeEnd, connection] {
+                _recordBlockingLeg(computeEnd, computeEnd);
+                _onBlockingCallDone(shard, connection, requestQueuedAt);
+            };
+            if (_dataFile) {
+                _ioUringReactor.readRandomBlock(*_dataFile, std::move(onCompletion));
+            } else {
+                _ioUringReactor.sleepFor(timeToSleep, std::move(onCompletion));
+            }
+            break;
+        }
+        }
+    };
+}
 
-        _blockingCallsThreadPool.queueJob(
-            [this, timeToSleep, localStats, threadMigrations] {
-            _sleep(std::chrono::duration_cast<std::chrono::microseconds>(timeToSleep));
+Task MultithreadedWorkload::ThreadPoolWorkload::_continuationJob(
+    Connection* connection, std::chrono::steady_clock::time_point requestQueuedAt) {
+    auto queuedAt = std::chrono::steady_clock::now();
+    return [this, requestQueuedAt, queuedAt, connection] {
+        Stats localStats;
+        auto computeStart = std::chrono::steady_clock::now();
+        int threadMigrations = 0;
 
-            if (!_terminate.load(std::memory_order_relaxed)) {
-                auto workloadQueueSize = _unblockedWorkloadThreadPool.queueSize();
-                if ((workloadQueueSize < 5 ||
-                     _unblockedWorkloadThreadPool.spareCapacity() >= workloadQueueSize) &&
-                    _blockingCallsThreadPool.spareCapacity() > 10) {
-                    _unblockedWorkloadThreadPool.queueJob(unblockedWorkloadThreadPoolJob());
-                    _unblockedWorkloadThreadPool.queueJob(unblockedWorkloadThreadPoolJob());
-                }
+        if (ThreadPool::isShed() || _terminate.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        if (connection) {
+            connection->session[connection->requests % connection->session.size()] +=
+                connection->requests;
+        }
+        while (true) {
+            threadMigrations += _workload->unitOfWork();
+            if (++localStats.iterations >= _iterationsBeforeSleep) {
+                break;
             }
+        }
+        auto computeEnd = std::chrono::steady_clock::now();
+
+        _stats.add(localStats.iterations, threadMigrations);
+        _stats.recordLatencies([&](RequestLatencies& latencies) {
+            latencies.continuationQueueWait.record(computeStart - queuedAt);
+            latencies.compute.record(computeEnd - computeStart);
+            latencies.endToEnd.record(computeEnd - requestQueuedAt);
         });
+
+        int shard = _unblockedWorkloadThreadPool->currentShard();
+        if (connection) {
+            Task job = unblockedWorkloadThreadPoolJob(connection);
+            JobBatch::queue(_unblockedWorkloadThreadPool.get(), shard, { &job, 1 },
+                            _connectionPriority());
+            return;
+        }
+        _admitNewWork(shard);
     };
 }
 
+void MultithreadedWorkload::ThreadPoolWorkload::resetStats() {
+    auto churn = _threadChurn();
+    auto wakeups = _wakeupStats();
+    auto admission = _admissionStats();
+    std::lock_guard<std::mutex> guard(_mutex);
+    _stats.reset();
+    _measurementsStart = std::chrono::high_resolution_clock::now();
+    _threadChurnAtReset = churn;
+    _wakeupsAtReset = wakeups;
+    _admissionAtReset = admission;
+}
+
+Stats MultithreadedWorkload::ThreadPoolWorkload::getStats() const {
+    auto churn = _threadChurn();
+    auto wakeups = _wakeupStats();
+    auto admission = _admissionStats();
+    auto stats = ThreadWorkload::getStats();
+    std::lock_guard<std::mutex> guard(_mutex);
+    stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - _measurementsStart);
+    stats.threadsSpawned = churn.spawned - _threadChurnAtReset.spawned;
+    stats.threadsRetired = churn.retired - _threadChurnAtReset.retired;
+    stats.wakeups = wakeups;
+    stats.wakeups -= _wakeupsAtReset;
+    stats.admission = admission;
+    stats.admission -= _admissionAtReset;
+    return stats;
+}
+
+void MultithreadedWorkload::ThreadPoolWorkload::appendSchedStats(
+    std::map<std::string, SchedStats>* byName) const {
+    (*byName)["pooledCompute"] += _unblockedWorkloadThreadPool->schedStats();
+    if (_usesBlockingThreadPool()) {
+        (*byName)["pooledBlocking"] += _blockingCallsThreadPool->schedStats();
+    }
+}
+
+ThreadPool::ThreadChurn MultithreadedWorkload::ThreadPoolWorkload::_threadChurn() const {
+    auto unblocked = _unblockedWorkloadThreadPool->threadChurn();
+    auto blocking = _blockingCallsThreadPool->threadChurn();
+    return { unblocked.spawned + blocking.spawned, unblocked.retired + blocking.retired };
+}
+
+ThreadPool::WakeupStats MultithreadedWorkload::ThreadPoolWorkload::_wakeupStats() const {
+    auto stats = _unblockedWorkloadThreadPool->wakeupStats();
+    stats += _blockingCallsThreadPool->wakeupStats();
+    return stats;
+}
+
+AdmissionStats MultithreadedWorkload::ThreadPoolWorkload::_admissionStats() const {
+    auto stats = _unblockedWorkloadThreadPool->admissionStats();
+    stats += _blockingCallsThreadPool->admissionStats();
+    return stats;
+}
+
+JobPriority MultithreadedWorkload::ThreadPoolWorkload::_continuationPriority() const {
+    return _poolConfig.prioritizeContinuations || _poolConfig.unblockedPool.admission.enabled()
+        ? JobPriority::kHigh
+        : JobPriority::kNormal;
+}
+
+JobPriority MultithreadedWorkload::ThreadPoolWorkload::_connectionPriority() const {
+    return _poolConfig.prioritizeContinuations || _poolConfig.unblockedPool.admission.enabled()
+        ? JobPriority::kHigh
+        : JobPriority::kNormal;
+}
+
+void MultithreadedWorkload::ThreadPoolWorkload::_recordBlockingLeg(
+    std::chrono::steady_clock::time_point blockQueuedAt,
+    std::chrono::steady_clock::time_point blockStart) {
+    auto now = std::chrono::steady_clock::now();
+    _stats.recordLatencies([&](RequestLatencies& latencies) {
+        if (_usesBlockingThreadPool()) {
+            latencies.blockingQueueWait.record(blockStart - blockQueuedAt);
+        }
+        latencies.block.record(now - blockStart);
+    });
+}
+
+bool MultithreadedWorkload::ThreadPoolWorkload::_usesBlockingThreadPool() const {
+    return _poolConfig.blockingBackend == PooledWorkloadConfig::BlockingBackend::kThreadPool;
+}
+
+void MultithreadedWorkload::ThreadPoolWorkload::_onBlockingCallDone(
+    int shard, Connection* connection, std::chrono::steady_clock::time_point requestQueuedAt) {
+    if (_terminate.load(std::memory_order_relaxed)) {
+        return;
+    }
+    Task continuation = _continuationJob(connection, requestQueuedAt);
+    JobBatch::queue(_unblockedWorkloadThreadPool.get(), shard, { &continuation, 1 },
+                    _continuationPriority());
+    if (!connection) {
+        _admitNewWork(shard);
+    }
+}
+
+void MultithreadedWorkload::ThreadPoolWorkload::_admitNewWork(int shard) {
+    if (_terminate.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // Async backends have no thread limit for blocking calls.
+    bool blockingHasCapacity =
+        !_usesBlockingThreadPool() || _blockingCallsThreadPool->spareCapacity() > 10;
+    // The admission controller of the pool bounds the supply by itself.
+    bool workloadHasCapacity = _poolConfig.unblockedPool.admission.enabled();
+    if (!workloadHasCapacity) {
+        auto workloadQueueSize = _unblockedWorkloadThreadPool->queueSize();
+        workloadHasCapacity = workloadQueueSize < 5 ||
+            _unblockedWorkloadThreadPool->spareCapacity() >= workloadQueueSize;
+    }
+    if (workloadHasCapacity && blockingHasCapacity) {
+        Task admission = unblockedWorkloadThreadPoolJob();
+        JobBatch::queue(_unblockedWorkloadThreadPool.get(), shard, { &admission, 1 });
+    }
+}
+
 std::string MultithreadedWorkload::ThreadPoolWorkload::status() const {
-    return "workloads running: " + std::to_string(_unblockedWorkloadThreadPool.currentlyRunning()) +
-        " blocking running: " + std::to_string(_blockingCallsThreadPool.currentlyRunning());
+    auto status =
+        "workloads running: " + std::to_string(_unblockedWorkloadThreadPool->currentlyRunning());
+    if (_usesBlockingThreadPool()) {
+        return status + " blocking running: " +
+            std::to_string(_blockingCallsThreadPool->currentlyRunning());
+    }
+    if (_poolConfig.blockingBackend == PooledWorkloadConfig::BlockingBackend::kIoUring) {
+        return status + " pending io_uring operations: " +
+            std::to_string(_ioUringReactor.pendingOperations());
+    }
+    return status + " pending timers: " + std::to_string(_timerReactor.pendingTimers());
+}
+
+MultithreadedWorkload::ThreadCoroutineWorkload::ThreadCoroutineWorkload(
+    std::unique_ptr<Workload> workload, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+    int threadCount, int concurrentRequests, const ThreadPoolOptions& poolOptions)
+    : ThreadWorkload(std::move(workload)),
+      _ratioOfTimeToBlock(ratioOfTimeToBlock),
+      _iterationsBeforeSleep(iterationsBeforeSleep),
+      _threadCount(threadCount),
+      _concurrentRequests(concurrentRequests),
+      _threadPool(ThreadPool::create(poolOptions)) {
+        assert(_iterationsBeforeSleep >= 1);
+        assert(threadCount >= 1);
+        assert(concurrentRequests >= 1);
+}
+
+MultithreadedWorkload::ThreadCoroutineWorkload::~ThreadCoroutineWorkload() {
+    // Suspended coroutines are owned by the reactor and the pool, let them all finish
+    // before those are stopped.
+    _terminate = true;
+    while (_runningRequests.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    _threadPool->stop();
+    _timerReactor.stop();
+}
+
+void MultithreadedWorkload::ThreadCoroutineWorkload::start() {
+    _threadPool->start(_threadCount);
+    _timerReactor.start();
+    while (!_threadPool->isWarm()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    for (int i = 0; i < _concurrentRequests; ++i) {
+        _requestLoop();
+    }
+}
+
+DetachedTask MultithreadedWorkload::ThreadCoroutineWorkload::_requestLoop() {
+    ++_runningRequests;
+    // A request starts when its resumption is queued to the pool and ends when its
+    // sleep timer fires.
+    auto queuedAt = std::chrono::steady_clock::now();
+    co_await ScheduleOn(*_threadPool);
+
+    while (!_terminate.load(std::memory_order_relaxed)) {
+        auto iterationStart = std::chrono::high_resolution_clock::now();
+        auto computeStart = std::chrono::steady_clock::now();
+        int iterations = 0;
+        int threadMigrations = 0;
+        while (iterations < _iterationsBeforeSleep) {
+            threadMigrations += _workload->unitOfWork();
+            ++iterations;
+        }
+
+        auto now = std::chrono::high_resolution_clock::now();
+        auto computeEnd = std::chrono::steady_clock::now();
+        _stats.add(iterations, threadMigrations);
+        _stats.recordLatencies([&](RequestLatencies& latencies) {
+            latencies.computeQueueWait.record(computeStart - queuedAt);
+            latencies.compute.record(computeEnd - computeStart);
+        });
+
+        auto firedAt = co_await SleepFor(
+            _timerReactor, *_threadPool, timeToBlock(now - iterationStart, _ratioOfTimeToBlock));
+        _stats.recordLatencies([&](RequestLatencies& latencies) {
+            latencies.block.record(firedAt - computeEnd);
+            latencies.endToEnd.record(firedAt - queuedAt);
+        });
+        queuedAt = firedAt;
+    }
+    --_runningRequests;
+}
+
+Stats MultithreadedWorkload::ThreadCoroutineWorkload::getStats() const {
+    auto stats = ThreadWorkload::getStats();
+    std::lock_guard<std::mutex> guard(_mutex);
+    stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - _measurementsStart);
+    return stats;
+}
+
+void MultithreadedWorkload::ThreadCoroutineWorkload::appendSchedStats(
+    std::map<std::string, SchedStats>* byName) const {
+    (*byName)["coroutine"] += _threadPool->schedStats();
+}
+
+std::string MultithreadedWorkload::ThreadCoroutineWorkload::status() const {
+    return "workloads running: " + std::to_string(_threadPool->currentlyRunning()) +
+        " pending timers: " + std::to_string(_timerReactor.pendingTimers());
+}
+
+MultithreadedWorkload::ThreadFiberWorkload::ThreadFiberWorkload(
+    std::unique_ptr<Workload> workload, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+    int threadCount, int concurrentRequests, const FiberWorkloadConfig& fiberConfig)
+    : ThreadWorkload(std::move(workload)),
+      _ratioOfTimeToBlock(ratioOfTimeToBlock),
+      _iterationsBeforeSleep(iterationsBeforeSleep),
+      _threadCount(threadCount),
+      _concurrentRequests(concurrentRequests),
+      _fiberConfig(fiberConfig),
+      _carriers(ThreadPool::create(fiberConfig.carriers)) {
+        assert(_iterationsBeforeSleep >= 1);
+        assert(threadCount >= 1);
+        assert(concurrentRequests >= 1);
+}
+
+MultithreadedWorkload::ThreadFiberWorkload::~ThreadFiberWorkload() {
+    // Suspended fibers are resumed by the reactors and the carriers, let them all finish
+    // before those are stopped.
+    _terminate = true;
+    while (_runningRequests.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    _carriers->stop();
+    _timerReactor.stop();
+    _ioUringReactor.stop();
+}
+
+void MultithreadedWorkload::ThreadFiberWorkload::start() {
+    _carriers->start(_threadCount);
+    if (_dataFile) {
+        _ioUringReactor.start(IoUringOptions());
+    } else {
+        _timerReactor.start();
+    }
+    while (!_carriers->isWarm()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    for (int i = 0; i < _concurrentRequests; ++i) {
+        _fibers.push_back(
+            std::make_unique<Fiber>([this] { _requestLoop(); }, _fiberConfig.stackSize));
+    }
+    _runningRequests = _concurrentRequests;
+    for (auto& fiber : _fibers) {
+        _carriers->queueJob([this, fiber = fiber.get()] { _resume(fiber); });
+    }
+}
+
+void MultithreadedWorkload::ThreadFiberWorkload::_requestLoop() {
+    // A request starts when its resumption is queued to the carriers and ends when its
+    // blocking call completes.
+    auto queuedAt = std::chrono::steady_clock::now();
+    while (!_terminate.load(std::memory_order_relaxed)) {
+        auto blockFor = _compute(queuedAt);
+        auto blockStart = std::chrono::steady_clock::now();
+        auto blockEnd = _blockingCallOnFiber(blockFor);
+        _stats.recordLatencies([&](RequestLatencies& latencies) {
+            latencies.block.record(blockEnd - blockStart);
+            latencies.endToEnd.record(blockEnd - queuedAt);
+        });
+        queuedAt = blockEnd;
+    }
+}
+
+std::chrono::microseconds MultithreadedWorkload::ThreadFiberWorkload::_compute(
+    TimePoint queuedAt) {
+    auto iterationStart = std::chrono::high_resolution_clock::now();
+    auto computeStart = std::chrono::steady_clock::now();
+    int threadMigrations = 0;
+    for (int i = 0; i < _iterationsBeforeSleep; ++i) {
+        threadMigrations += _workload->unitOfWork();
+    }
+    auto computeEnd = std::chrono::steady_clock::now();
+
+    _stats.add(_iterationsBeforeSleep, threadMigrations);
+    _stats.recordLatencies([&](RequestLatencies& latencies) {
+        latencies.computeQueueWait.record(computeStart - queuedAt);
+        latencies.compute.record(computeEnd - computeStart);
+    });
+    return timeToBlock(std::chrono::high_resolution_clock::now() - iterationStart,
+                       _ratioOfTimeToBlock);
+}
+
+MultithreadedWorkload::ThreadFiberWorkload::TimePoint
+MultithreadedWorkload::ThreadFiberWorkload::_blockingCallOnFiber(
+    std::chrono::microseconds blockFor) {
+    auto fiber = Fiber::current();
+    int shard = _carriers->currentShard();
+    // Lives on the fiber stack until the fiber resumes.
+    TimePoint completedAt;
+    Fiber::suspend([this, fiber, shard, blockFor, &completedAt] {
+        auto onCompletion = [this, fiber, shard, &completedAt] {
+            completedAt = std::chrono::steady_clock::now();
+            _carriers->queueJobToShard(shard, [this, fiber] { _resume(fiber); });
+        };
+        if (_dataFile) {
+            _ioUringReactor.readRandomBlock(*_dataFile, std::move(onCompletion));
+        } else {
+            _timerReactor.schedule(TimerReactor::Clock::now() + blockFor, std::move(onCompletion));
+        }
+    });
+    return completedAt;
+}
+
+void MultithreadedWorkload::ThreadFiberWorkload::_resume(Fiber* fiber) {
+    fiber->resume();
+    if (fiber->finished()) {
+        --_runningRequests;
+    }
+}
+
+Stats MultithreadedWorkload::ThreadFiberWorkload::getStats() const {
+    auto stats = ThreadWorkload::getStats();
+    std::lock_guard<std::mutex> guard(_mutex);
+    stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - _measurementsStart);
+    return stats;
+}
+
+void MultithreadedWorkload::ThreadFiberWorkload::appendSchedStats(
+    std::map<std::string, SchedStats>* byName) const {
+    (*byName)["fiber"] += _carriers->schedStats();
+}
+
+std::string MultithreadedWorkload::ThreadFiberWorkload::status() const {
+    auto status = "fibers running: " + std::to_string(_carriers->currentlyRunning());
+    if (_dataFile) {
+        return status + " pending io_uring operations: " +
+            std::to_string(_ioUringReactor.pendingOperations());
+    }
+    return status + " pending timers: " + std::to_string(_timerReactor.pendingTimers());
+}
+
+MultithreadedWorkload::ThreadOpenLoopWorkload::ThreadOpenLoopWorkload(
+    std::unique_ptr<Workload> workload, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+    int threadCount, const OpenLoopOptions& options)
+    : ThreadWorkload(std::move(workload)),
+      _ratioOfTimeToBlock(ratioOfTimeToBlock),
+      _iterationsBeforeSleep(iterationsBeforeSleep),
+      _threadCount(threadCount),
+      _options(options),
+      _threadPool(ThreadPool::create(options.pooled.unblockedPool)) {
+        assert(_iterationsBeforeSleep >= 1);
+        assert(threadCount >= 1);
+        assert(options.requestsPerSecond > 0);
+        if (_options.model == OpenLoopOptions::Model::kPooled &&
+            _options.pooled.blockingBackend == PooledWorkloadConfig::BlockingBackend::kThreadPool) {
+            _blockingCallsThreadPool = ThreadPool::create(options.pooled.blockingPool);
+        }
+}
+
+MultithreadedWorkload::ThreadOpenLoopWorkload::~ThreadOpenLoopWorkload() {
+    // No new arrivals, requests in flight skip their work but must leave the pools and
+    // reactors before those are stopped.
+    terminate();
+    while (_inFlight.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    _threadPool->stop();
+    if (_blockingCallsThreadPool) {
+        _blockingCallsThreadPool->stop();
+    }
+    _timerReactor.stop();
+    _ioUringReactor.stop();
+}
+
+void MultithreadedWorkload::ThreadOpenLoopWorkload::start() {
+    _threadPool->start(_threadCount);
+    if (_blockingCallsThreadPool) {
+        _blockingCallsThreadPool->start(std::min(_threadCount * 20, 800));
+    } else if (_options.model == OpenLoopOptions::Model::kPooled &&
+               _options.pooled.blockingBackend == PooledWorkloadConfig::BlockingBackend::kIoUring) {
+        _ioUringReactor.start(_options.pooled.ioUring);
+    } else if (_options.model != OpenLoopOptions::Model::kDedicatedThreads) {
+        _timerReactor.start();
+    }
+    while (!_threadPool->isWarm() ||
+           (_blockingCallsThreadPool && !_blockingCallsThreadPool->isWarm())) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    _thread = std::make_unique<std::thread>([this] { _driverLoop(); });
+}
+
+void MultithreadedWorkload::ThreadOpenLoopWorkload::_driverLoop() {
+    // The default 50 us timer slack would bunch up arrivals at high rates.
+    prctl(PR_SET_TIMERSLACK, 1);
+    int burstSize = _options.arrivals == OpenLoopOptions::Arrivals::kBursty ?
+        _options.burstSize : 1;
+    std::mt19937_64 gen;
+    std::exponential_distribution<double> interArrival(_options.requestsPerSecond / burstSize);
+    auto next = std::chrono::steady_clock::now();
+
+    while (!_terminate.load(std::memory_order_relaxed)) {
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(interArrival(gen)));
+        while (!_terminate.load(std::memory_order_relaxed) &&
+               std::chrono::steady_clock::now() < next) {
+            std::this_thread::sleep_until(
+                std::min(next, std::chrono::steady_clock::now() + std::chrono::milliseconds(10)));
+        }
+        // A driver running late still stamps the requests with the time they were due,
+        // so the delay shows up in their latency instead of being omitted.
+        for (int i = 0; i < burstSize && !_terminate.load(std::memory_order_relaxed); ++i) {
+            _issue(next);
+        }
+    }
+}
+
+void MultithreadedWorkload::ThreadOpenLoopWorkload::_issue(TimePoint intendedAt) {
+    _offered.fetch_add(1, std::memory_order_relaxed);
+    if (_inFlight.load(std::memory_order_relaxed) >= _options.maxInFlight) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    _inFlight.fetch_add(1, std::memory_order_relaxed);
+
+    switch (_options.model) {
+    case OpenLoopOptions::Model::kDedicatedThreads:
+        _threadPool->queueJob([this, intendedAt] {
+            if (ThreadPool::isShed()) {
+                _shed();
+                return;
+            }
+            auto timeToBlock = _compute(intendedAt);
+            auto blockStart = std::chrono::steady_clock::now();
+            if (!_terminate.load(std::memory_order_relaxed)) {
+                _blockingCall(timeToBlock);
+            }
+            _complete(intendedAt, blockStart, std::chrono::steady_clock::now());
+        });
+        break;
+    case OpenLoopOptions::Model::kPooled:
+        _threadPool->queueJob([this, intendedAt] {
+            if (ThreadPool::isShed()) {
+                _shed();
+                return;
+            }
+            _pooledBlockingLeg(intendedAt, _compute(intendedAt));
+        });
+        break;
+    case OpenLoopOptions::Model::kCoroutine:
+        _coroutineRequest(intendedAt);
+        break;
+    }
+}
+
+std::chrono::microseconds MultithreadedWorkload::ThreadOpenLoopWorkload::_compute(
+    TimePoint intendedAt) {
+    if (_terminate.load(std::memory_order_relaxed)) {
+        return std::chrono::microseconds{ 0 };
+    }
+    auto iterationStart = std::chrono::high_resolution_clock::now();
+    auto computeStart = std::chrono::steady_clock::now();
+    int threadMigrations = 0;
+    for (int i = 0; i < _iterationsBeforeSleep; ++i) {
+        threadMigrations += _workload->unitOfWork();
+    }
+    auto computeEnd = std::chrono::steady_clock::now();
+
+    _stats.add(_iterationsBeforeSleep, threadMigrations);
+    _stats.recordLatencies([&](RequestLatencies& latencies) {
+        latencies.computeQueueWait.record(computeStart - intendedAt);
+        latencies.compute.record(computeEnd - computeStart);
+    });
+    return timeToBlock(std::chrono::high_resolution_clock::now() - iterationStart,
+                       _ratioOfTimeToBlock);
+}
+
+void MultithreadedWorkload::ThreadOpenLoopWorkload::_pooledBlockingLeg(
+    TimePoint intendedAt, std::chrono::microseconds timeToBlock) {
+    auto computeEnd = std::chrono::steady_clock::now();
+    switch (_options.pooled.blockingBackend) {
+    case PooledWorkloadConfig::BlockingBackend::kThreadPool:
+        _blockingCallsThreadPool->queueJob([this, intendedAt, timeToBlock, computeEnd] {
+            if (ThreadPool::isShed()) {
+                _shed();
+                return;
+            }
+            auto blockStart = std::chrono::steady_clock::now();
+            _stats.recordLatencies([&](RequestLatencies& latencies) {
+                latencies.blockingQueueWait.record(blockStart - computeEnd);
+            });
+            if (!_terminate.load(std::memory_order_relaxed)) {
+                _blockingCall(timeToBlock);
+            }
+            _complete(intendedAt, blockStart, std::chrono::steady_clock::now());
+        });
+        break;
+    case PooledWorkloadConfig::BlockingBackend::kTimerReactor:
+        _timerReactor.schedule(TimerReactor::Clock::now() + timeToBlock,
+                               [this, intendedAt, computeEnd] {
+            _complete(intendedAt, computeEnd, std::chrono::steady_clock::now());
+        });
+        break;
+    case PooledWorkloadConfig::BlockingBackend::kIoUring: {
+        auto onCompletion = [this, intendedAt, computeEnd] {
+            _complete(intendedAt, computeEnd, std::chrono::steady_clock::now());
+        };
+        if (_dataFile) {
+            _ioUringReactor.readRandomBlock(*_dataFile, std::move(onCompletion));
+        } else {
+            _ioUringReactor.sleepFor(timeToBlock, std::move(onCompletion));
+        }
+        break;
+    }
+    }
+}
+
+DetachedTask MultithreadedWorkload::ThreadOpenLoopWorkload::_coroutineRequest(
+    TimePoint intendedAt) {
+    co_await ScheduleOn(*_threadPool);
+    // A shed resumption runs on the thread that shed it.
+    if (ThreadPool::isShed()) {
+        _shed();
+        co_return;
+    }
+    auto timeToBlock = _compute(intendedAt);
+    auto blockStart = std::chrono::steady_clock::now();
+    auto firedAt = co_await SleepFor(_timerReactor, *_threadPool, timeToBlock);
+    if (ThreadPool::isShed()) {
+        _shed();
+        co_return;
+    }
+    _complete(intendedAt, blockStart, firedAt);
+}
+
+void MultithreadedWorkload::ThreadOpenLoopWorkload::_complete(
+    TimePoint intendedAt, TimePoint blockStart, TimePoint end) {
+    _stats.recordLatencies([&](RequestLatencies& latencies) {
+        latencies.block.record(end - blockStart);
+        latencies.endToEnd.record(end - intendedAt);
+    });
+    _completed.fetch_add(1, std::memory_order_relaxed);
+    _inFlight.fetch_sub(1, std::memory_order_release);
+}
+
+void MultithreadedWorkload::ThreadOpenLoopWorkload::_shed() {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    _inFlight.fetch_sub(1, std::memory_order_release);
+}
+
+void MultithreadedWorkload::ThreadOpenLoopWorkload::resetStats() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _stats.reset();
+    _measurementsStart = std::chrono::high_resolution_clock::now();
+    _statsAtReset.offered = _offered.load();
+    _statsAtReset.dropped = _dropped.load();
+    _statsAtReset.completed = _completed.load();
+}
+
+Stats MultithreadedWorkload::ThreadOpenLoopWorkload::getStats() const {
+    auto stats = ThreadWorkload::getStats();
+    std::lock_guard<std::mutex> guard(_mutex);
+    stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - _measurementsStart);
+    return stats;
+}
+
+void MultithreadedWorkload::ThreadOpenLoopWorkload::appendSchedStats(
+    std::map<std::string, SchedStats>* byName) const {
+    (*byName)["openLoop"] += _threadPool->schedStats();
+    if (_blockingCallsThreadPool) {
+        (*byName)["openLoopBlocking"] += _blockingCallsThreadPool->schedStats();
+    }
+}
+
+void MultithreadedWorkload::ThreadOpenLoopWorkload::appendOpenLoopStats(
+    OpenLoopStats* stats) const {
+    std::lock_guard<std::mutex> guard(_mutex);
+    stats->duration = std::max(stats->duration,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - _measurementsStart));
+    stats->offered += _offered.load() - _statsAtReset.offered;
+    stats->dropped += _dropped.load() - _statsAtReset.dropped;
+    stats->completed += _completed.load() - _statsAtReset.completed;
+}
+
+std::string MultithreadedWorkload::ThreadOpenLoopWorkload::status() const {
+    return "requests in flight: " + std::to_string(_inFlight.load()) +
+        " dropped: " + std::to_string(_dropped.load());
 }
 
 }  // namespace testing
-}  // namespace blocking_to_async 
+}  // namespace blocking_to_async
@@ -4,18 +4,33 @@
  * @date 2022-07-18
  */
 
+#pragma once
+
+#include <array>
 #include <atomic>
 #include <cassert>
 #include <condition_variable>
 #include <cstddef>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <ostream>
+#include <string>
 #include <thread>
-
+#include <vector>
+
+#include "benchmarks/coroutine.h"
+#include "benchmarks/disk_io.h"
+#include "benchmarks/fiber.h"
+#include "benchmarks/io_uring_reactor.h"
+#include "benchmarks/latency_histogram.h"
+#include "benchmarks/locks.h"
+#include "benchmarks/memory_arena.h"
+#include "benchmarks/stats_recorder.h"
 #include "benchmarks/thread_pool.h"
+#include "benchmarks/timer_reactor.h"
 
 namespace blocking_to_async {
 namespace testing {
@@ -33,16 +48,137 @@ struct Config {
     size_t sharedDataSize = kExpectedL2CacheSize * 1000 * 2.5;
     size_t memoryWorkSizePerIteration = kExpectedL1CacheSize / 4;
 
+    // Backing store of the shared data of `ContinuousWorkload`.
+    enum class SharedData {
+        // Fragmented deque grown in small steps.
+        kDeque,
+        // One mapping configured by `arena`.
+        kArena,
+    };
+    SharedData sharedData = SharedData::kDeque;
+    ArenaOptions arena;
+
+    // Lock of the contended critical sections in `ContinuousWorkload` and the lock convoy.
+    LockKind shardLock = LockKind::kMutex;
+
+    // Name of the unit of work in `WorkloadRegistry`.
+    std::string workload = "continuous";
+
     // This is filled up by calibration results.
     OptimalConcurrency optimalConcurrency;
 };
 
+// How the blocking part of a request is emulated.
+struct BlockingCallOptions {
+    enum class Kind {
+        // Interruptible sleep for the time computed from the blocking ratio.
+        kSleep,
+        // Real reads of a data file, see `DiskReadOptions`.
+        kDiskRead,
+    };
+
+    Kind kind = Kind::kSleep;
+    DiskReadOptions diskRead;
+
+    bool operator==(const BlockingCallOptions& other) const = default;
+};
+
+// Setup of the pooled workload, the defaults match the original shared queue pools.
+struct PooledWorkloadConfig {
+    enum class BlockingBackend {
+        // Every blocking call parks a thread of the blocking calls thread pool.
+        kThreadPool,
+        // Blocking calls are timers on a single reactor thread, the continuation is
+        // queued back to the unblocked workload pool when the timer fires.
+        kTimerReactor,
+        // Blocking calls are io_uring timeouts, or reads of the data file when the
+        // blocking call is `kDiskRead`. Completion reaping threads
+        // queue the continuation back to the unblocked workload pool.
+        kIoUring,
+    };
+
+    // With `unblockedPool.admission` enabled the pool sheds jobs of the shared supply
+    // instead of the workload throttling itself by the queue size. Requests of connections
+    // and continuations are queued with `JobPriority::kHigh` then, a shed one would end its
+    // connection or a request that already blocked.
+    ThreadPoolOptions unblockedPool;
+    // Only used by the `kThreadPool` backend.
+    ThreadPoolOptions blockingPool;
+    BlockingBackend blockingBackend = BlockingBackend::kThreadPool;
+    // Only used by the `kIoUring` backend.
+    IoUringOptions ioUring;
+    // Logical client connections, each with a small state object and one request in
+    // flight at a time. Zero keeps the original self-replicating job supply.
+    int connections = 0;
+    // The continuation stage that finishes a request after its blocking call is queued
+    // with `JobPriority::kHigh`, ahead of the jobs that admit new work.
+    bool prioritizeContinuations = false;
+    // Compute jobs per request before its blocking call, each stage queues the next one
+    // from the worker that ran it. The continuation stage after the call comes on top.
+    int computeStages = 1;
+};
+
+// Setup of the fiber workload.
+struct FiberWorkloadConfig {
+    // Carrier threads the fibers are multiplexed over, one shard per core with pinned
+    // workers by default.
+    ThreadPoolOptions carriers{ .pinning = ThreadPoolOptions::Pinning::kPerCore };
+    size_t stackSize = Fiber::kDefaultStackSize;
+};
+
+// Requests of the open loop driver arrive on their own schedule regardless of how fast
+// the thread model completes them.
+struct OpenLoopOptions {
+    enum class Arrivals {
+        // Exponentially distributed inter-arrival times.
+        kPoisson,
+        // Poisson arrivals of bursts of `burstSize` requests, same mean rate.
+        kBursty,
+    };
+
+    enum class Model {
+        // Every request holds one of the pool threads for both compute and block.
+        kDedicatedThreads,
+        // Compute on a pool, blocking calls on `pooled.blockingBackend`.
+        kPooled,
+        // Every request is a coroutine on a pool, blocking calls are reactor timers.
+        kCoroutine,
+    };
+
+    double requestsPerSecond = 1000;
+    Arrivals arrivals = Arrivals::kPoisson;
+    int burstSize = 16;
+    Model model = Model::kPooled;
+    // Pools and blocking backend of the `kPooled` model, the other models use the
+    // options of `pooled.unblockedPool` for their only pool.
+    PooledWorkloadConfig pooled;
+    // Arrivals beyond this many requests in flight are dropped and counted.
+    int maxInFlight = 100000;
+};
+
+// Request counts of the open loop driver since `resetStats()`.
+struct OpenLoopStats {
+    std::chrono::microseconds duration{ 0 };
+    uint64_t offered = 0;
+    uint64_t dropped = 0;
+    uint64_t completed = 0;
+};
+
 struct Stats {
     std::chrono::microseconds duration{ 0 };
     uint64_t iterations = 0;
     int threadMigrations = 0;
     int minflt = 0;
     int majflt = 0;
+    // Threads spawned and retired by elastic pools.
+    int64_t threadsSpawned = 0;
+    int64_t threadsRetired = 0;
+    // Wakeups of parked pool workers.
+    ThreadPool::WakeupStats wakeups;
+    // Jobs shed by the admission control of the pools.
+    AdmissionStats admission;
+    // Counters of the workload threads.
+    PerfCounts perf;
 
     double qps() const;
     double migrationsQps() const;
@@ -56,6 +192,9 @@ struct Stats {
     Stats diff(const Stats& other) const;
 
     static std::tuple<int, int> getPageFaults();
+
+    // Bytes allocated by malloc and still in use, resident set size in bytes.
+    static std::tuple<size_t, size_t> getMemoryUsage();
 };
 
 inline std::ostream& operator<<(std::ostream& os, const Stats& s) {
@@ -64,9 +203,26 @@ inline std::ostream& operator<<(std::ostream& os, const Stats& s) {
     if (s.threadMigrations > 0) { os << " Migrations: " << s.migrationsQps() << " /s"; }
     if (s.minflt > 0) { os << " minflt: " << s.minflt; }
     if (s.majflt > 0) { os << " minflt: " << s.majflt; }
+    if (s.perf.contextSwitches > 0) { os << " context switches: " << s.perf.contextSwitches; }
+    if (s.perf.cycles > 0) { os << " IPC: " << double(s.perf.instructions) / s.perf.cycles; }
+    if (s.threadsSpawned > 0 || s.threadsRetired > 0) {
+        os << " threads spawned: " << s.threadsSpawned << " retired: " << s.threadsRetired;
+    }
+    if (s.wakeups.wakeups > 0) {
+        os << " wakeups: " << s.wakeups.wakeups << " spurious: " << s.wakeups.spuriousWakeups;
+    }
+    if (s.admission.shed() > 0) {
+        os << " rejected: " << s.admission.rejected << " shed oldest: "
+           << s.admission.shedOldest << " shed late: " << s.admission.shedLate;
+    }
     return os;
 }
 
+// Time to block after being active for `timeActive` to keep the ratio of time blocked,
+// with up to 2.5% of random jitter.
+std::chrono::microseconds timeToBlock(
+    std::chrono::high_resolution_clock::duration timeActive, double ratioOfTimeToBlock);
+
 class Workload {
 public:
     virtual ~Workload() = default;
@@ -88,10 +244,34 @@ public:
 
     void scaleNonBlockingWorkloadTo(int newThreadCount);
 
+    // Applies to the blocking, pooled and fiber workloads started afterwards. The
+    // coroutine workload and the timer reactor backend always sleep.
+    void setBlockingCall(const BlockingCallOptions& options);
+
     void resetBlockingWorkflowTo(int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep);
 
-    void startPooledWorkload(int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep);
+    void startPooledWorkload(int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+                             const PooledWorkloadConfig& poolConfig = PooledWorkloadConfig());
+
+    // Request loops written as C++20 coroutines, `concurrentRequests` of them run on
+    // a pool of `threadCount` threads.
+    void startCoroutineWorkload(int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+                                int concurrentRequests,
+                                const ThreadPoolOptions& poolOptions = ThreadPoolOptions());
 
+    // Request loops written as straight line blocking code, `concurrentRequests` of them
+    // run on fibers multiplexed over `threadCount` carrier threads.
+    void startFiberWorkload(int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+                            int concurrentRequests,
+                            const FiberWorkloadConfig& fiberConfig = FiberWorkloadConfig());
+
+    // Requests issued at the arrival rate of `options` into the thread model of
+    // `options`, latencies are measured from the intended arrival time. The pools have
+    // `threadCount` threads, the blocking pool of the pooled model 20 times more.
+    void startOpenLoopWorkload(int threadCount, double ratioOfTimeToBlock, int iterationsBeforeSleep,
+                               const OpenLoopOptions& options);
+
+    // Stops the pooled, coroutine, fiber and open loop workloads.
     void stopPooledWorkload();
 
     // Reset at the beginning of an experiment.
@@ -99,6 +279,15 @@ public:
 
     Stats getStats() const;
 
+    // Merged request latencies of all workloads since `resetStats()`.
+    RequestLatencies getLatencies() const;
+
+    // Accounting of the workload threads since they started, keyed by workload type.
+    // The pooled workload reports its compute and blocking pools separately.
+    std::map<std::string, SchedStats> getSchedStats() const;
+
+    OpenLoopStats getOpenLoopStats() const;
+
     std::string status() const;
 
 private:
@@ -106,7 +295,10 @@ private:
     // only does `unitOfWork()`.
     class ThreadWorkload {
     public:
-        enum class WorkloadType { kNonBlocking, kBlocking, kBlockingPooled };
+        enum class WorkloadType {
+            kNonBlocking, kBlocking, kBlockingPooled, kBlockingCoroutine, kBlockingFiber,
+            kOpenLoop
+        };
 
         explicit ThreadWorkload(std::unique_ptr<Workload> workload);
         ThreadWorkload(ThreadWorkload& other) = delete;
@@ -120,17 +312,26 @@ private:
         virtual void start();
 
         virtual void resetStats() {
-            std::lock_guard<std::mutex> guard(_mutex);
-            _stats = Stats();
+            _stats.reset();
         }
 
-        Stats getStats() const {
-            std::lock_guard<std::mutex> guard(_mutex);
-            return _stats;
+        virtual Stats getStats() const;
+
+        RequestLatencies getLatencies() const {
+            return _stats.latencies();
         }
 
+        virtual void appendSchedStats(std::map<std::string, SchedStats>* byName) const;
+
+        virtual void appendOpenLoopStats(OpenLoopStats* stats) const {}
+
         void terminate();
 
+        // Must be called before `start()`, null means the blocking call is a sleep.
+        void setDataFile(std::shared_ptr<const DataFile> dataFile) {
+            _dataFile = std::move(dataFile);
+        }
+
         virtual std::string status() const { return ""; }
 
         // Get current CPU core ID.
@@ -140,12 +341,22 @@ private:
         // Sleep that supports being interrupted.
         void _sleep(std::chrono::microseconds sleepFor);
 
+        // Either `_sleep()` for `blockFor` or reads of the data file, which take as long
+        // as the storage does.
+        void _blockingCall(std::chrono::microseconds blockFor);
+
         std::unique_ptr<std::thread> _thread;
         std::unique_ptr<Workload> _workload;
+        std::shared_ptr<const DataFile> _dataFile;
         std::atomic<bool> _terminate;
 
+        // Guards the measurement bookkeeping of subclasses, not taken per request.
         mutable std::mutex _mutex;
-        Stats _stats;
+        StatsRecorder _stats;
+        ThreadCpuAccountingGroup _threadAccounting;
+
+        // Guards the sleep state below.
+        std::mutex _sleepMutex;
 
         std::vector<std::unique_ptr<std::condition_variable>> _perCoreSleepCv;
         int _currentSleepDeprivedCore = 0;
@@ -179,7 +390,8 @@ private:
         ThreadPoolWorkload(std::unique_ptr<Workload> workload, 
                            double ratioOfTimeToBlock,
                            int iterationsBeforeSleep,
-                           int threadCount);
+                           int threadCount,
+                           const PooledWorkloadConfig& poolConfig);
         ~ThreadPoolWorkload() override;
 
         WorkloadType workloadType() const override {
@@ -188,25 +400,258 @@ private:
 
         void start() override;
 
+        void resetStats() override;
+
+        Stats getStats() const override;
+
+        void appendSchedStats(std::map<std::string, SchedStats>* byName) const override;
+
+        std::string status() const override;
+
+    private:
+        // Per client state of `PooledWorkloadConfig::connections`, touched by every
+        // request of the connection.
+        struct Connection {
+            uint64_t requests = 0;
+            std::chrono::steady_clock::time_point lastRequestAt;
+            std::array<uint64_t, 4> session{};
+        };
+
+        // Job of the next request of `connection`, or of the shared job supply when null.
+        Task unblockedWorkloadThreadPoolJob(Connection* connection = nullptr);
+
+        // Job of compute stage `stage` of a request that entered the pool at
+        // `requestQueuedAt`.
+        Task _computeStageJob(Connection* connection,
+                              std::chrono::steady_clock::time_point requestQueuedAt, int stage);
+
+        // Job of the compute stage that finishes the request after its blocking call and
+        // records its end to end latency.
+        Task _continuationJob(Connection* connection,
+                              std::chrono::steady_clock::time_point requestQueuedAt);
+
+        // Sum of both pools since `start()`.
+        ThreadPool::ThreadChurn _threadChurn() const;
+        ThreadPool::WakeupStats _wakeupStats() const;
+        AdmissionStats _admissionStats() const;
+        // `JobPriority::kHigh` when a request of a connection must not be shed.
+        JobPriority _connectionPriority() const;
+        // `JobPriority::kHigh` when continuations are prioritized, or must not be shed
+        // because their request already did most of its work.
+        JobPriority _continuationPriority() const;
+
+        bool _usesBlockingThreadPool() const;
+
+        // Records the latencies of a request whose blocking leg just completed. The async
+        // backends have no queue in front of the blocking call, `blockStart` equals
+        // `blockQueuedAt` for them.
+        void _recordBlockingLeg(std::chrono::steady_clock::time_point blockQueuedAt,
+                                std::chrono::steady_clock::time_point blockStart);
+
+        // Queues the continuation of the request to `shard` of the workload pool after
+        // its blocking call completed, and admits a new job of the shared supply.
+        void _onBlockingCallDone(int shard, Connection* connection,
+                                 std::chrono::steady_clock::time_point requestQueuedAt);
+
+        // Queues a new job of the shared supply to `shard` when both pools have room.
+        void _admitNewWork(int shard);
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> _measurementsStart =
+            std::chrono::high_resolution_clock::now();
+        const double _ratioOfTimeToBlock;
+        const int _iterationsBeforeSleep;
+        const int _threadCount;
+        const PooledWorkloadConfig _poolConfig;
+
+        std::unique_ptr<ThreadPool> _unblockedWorkloadThreadPool;
+        std::unique_ptr<ThreadPool> _blockingCallsThreadPool;
+        // Guarded by `_mutex`.
+        ThreadPool::ThreadChurn _threadChurnAtReset;
+        ThreadPool::WakeupStats _wakeupsAtReset;
+        AdmissionStats _admissionAtReset;
+        TimerReactor _timerReactor;
+        IoUringReactor _ioUringReactor;
+        std::vector<Connection> _connections;
+    };
+
+    // Same work as `ThreadPoolWorkload` written as straight line code: every request is
+    // a coroutine loop that `co_await`s an async sleep and resumes on the thread pool.
+    class ThreadCoroutineWorkload : public ThreadWorkload {
+    public:
+        ThreadCoroutineWorkload(std::unique_ptr<Workload> workload,
+                                double ratioOfTimeToBlock,
+                                int iterationsBeforeSleep,
+                                int threadCount,
+                                int concurrentRequests,
+                                const ThreadPoolOptions& poolOptions);
+        ~ThreadCoroutineWorkload() override;
+
+        WorkloadType workloadType() const override {
+            return ThreadWorkload::WorkloadType::kBlockingCoroutine;
+        }
+
+        void start() override;
+
+        void resetStats() override {
+            std::lock_guard<std::mutex> guard(_mutex);
+            _stats.reset();
+            _measurementsStart = std::chrono::high_resolution_clock::now();
+        }
+
+        Stats getStats() const override;
+
+        void appendSchedStats(std::map<std::string, SchedStats>* byName) const override;
+
+        std::string status() const override;
+
+    private:
+        DetachedTask _requestLoop();
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> _measurementsStart =
+            std::chrono::high_resolution_clock::now();
+        const double _ratioOfTimeToBlock;
+        const int _iterationsBeforeSleep;
+        const int _threadCount;
+        const int _concurrentRequests;
+
+        std::unique_ptr<ThreadPool> _threadPool;
+        TimerReactor _timerReactor;
+        // Request loops that did not finish yet, they must all exit before the pool stops.
+        std::atomic<int> _runningRequests{0};
+    };
+
+    // Same work as `ThreadPartiallyBlockedWorkload` with a blocking call in straight line
+    // code, but every request loop is a fiber. The blocking call suspends the fiber on the
+    // timer reactor, or on io_uring for reads of the data file, and the completion
+    // resumes it on the carrier shard it left.
+    class ThreadFiberWorkload : public ThreadWorkload {
+    public:
+        ThreadFiberWorkload(std::unique_ptr<Workload> workload,
+                            double ratioOfTimeToBlock,
+                            int iterationsBeforeSleep,
+                            int threadCount,
+                            int concurrentRequests,
+                            const FiberWorkloadConfig& fiberConfig);
+        ~ThreadFiberWorkload() override;
+
+        WorkloadType workloadType() const override {
+            return ThreadWorkload::WorkloadType::kBlockingFiber;
+        }
+
+        void start() override;
+
         void resetStats() override {
             std::lock_guard<std::mutex> guard(_mutex);
-            _stats = Stats();
+            _stats.reset();
             _measurementsStart = std::chrono::high_resolution_clock::now();
         }
 
+        Stats getStats() const override;
+
+        void appendSchedStats(std::map<std::string, SchedStats>* byName) const override;
+
         std::string status() const override;
 
     private:
-        std::function<void()> unblockedWorkloadThreadPoolJob();
+        using TimePoint = std::chrono::steady_clock::time_point;
+
+        // Body of every fiber, returns once the workload terminates.
+        void _requestLoop();
+
+        // Runs the units of work of a request and returns the time to block. Not inlined
+        // into the request loop, see `Fiber` about thread locals.
+        __attribute__((noinline)) std::chrono::microseconds _compute(TimePoint queuedAt);
+
+        // Suspends the current fiber for the blocking call, returns when the completion
+        // queued its resumption.
+        TimePoint _blockingCallOnFiber(std::chrono::microseconds blockFor);
+
+        // Runs `fiber` on the calling carrier until it suspends again.
+        void _resume(Fiber* fiber);
 
         std::chrono::time_point<std::chrono::high_resolution_clock> _measurementsStart =
             std::chrono::high_resolution_clock::now();
         const double _ratioOfTimeToBlock;
         const int _iterationsBeforeSleep;
         const int _threadCount;
+        const int _concurrentRequests;
+        const FiberWorkloadConfig _fiberConfig;
+
+        std::unique_ptr<ThreadPool> _carriers;
+        TimerReactor _timerReactor;
+        IoUringReactor _ioUringReactor;
+        std::vector<std::unique_ptr<Fiber>> _fibers;
+        // Fibers that did not finish yet, they must all exit before the carriers stop.
+        std::atomic<int> _runningRequests{0};
+    };
+
+    // Driver thread issuing requests at the arrival times of `OpenLoopOptions`, no
+    // request waits for another one to complete.
+    class ThreadOpenLoopWorkload : public ThreadWorkload {
+    public:
+        ThreadOpenLoopWorkload(std::unique_ptr<Workload> workload,
+                               double ratioOfTimeToBlock,
+                               int iterationsBeforeSleep,
+                               int threadCount,
+                               const OpenLoopOptions& options);
+        ~ThreadOpenLoopWorkload() override;
+
+        WorkloadType workloadType() const override {
+            return ThreadWorkload::WorkloadType::kOpenLoop;
+        }
+
+        void start() override;
+
+        void resetStats() override;
+
+        Stats getStats() const override;
+
+        void appendSchedStats(std::map<std::string, SchedStats>* byName) const override;
+
+        void appendOpenLoopStats(OpenLoopStats* stats) const override;
+
+        std::string status() const override;
+
+    private:
+        using TimePoint = std::chrono::steady_clock::time_point;
+
+        void _driverLoop();
+
+        // Dispatches one request that was due at `intendedAt`.
+        void _issue(TimePoint intendedAt);
+
+        // Runs the units of work of a request and returns the time to block.
+        std::chrono::microseconds _compute(TimePoint intendedAt);
+
+        void _pooledBlockingLeg(TimePoint intendedAt, std::chrono::microseconds timeToBlock);
+
+        DetachedTask _coroutineRequest(TimePoint intendedAt);
 
-        ThreadPool _unblockedWorkloadThreadPool;
-        ThreadPool _blockingCallsThreadPool;
+        // Records the blocking leg and the end to end latency from the intended arrival.
+        void _complete(TimePoint intendedAt, TimePoint blockStart, TimePoint end);
+
+        // Counts a request whose job a pool shed as dropped.
+        void _shed();
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> _measurementsStart =
+            std::chrono::high_resolution_clock::now();
+        const double _ratioOfTimeToBlock;
+        const int _iterationsBeforeSleep;
+        const int _threadCount;
+        const OpenLoopOptions _options;
+
+        std::unique_ptr<ThreadPool> _threadPool;
+        // Only used by the pooled model with the `kThreadPool` backend.
+        std::unique_ptr<ThreadPool> _blockingCallsThreadPool;
+        TimerReactor _timerReactor;
+        IoUringReactor _ioUringReactor;
+
+        std::atomic<int> _inFlight{ 0 };
+        std::atomic<uint64_t> _offered{ 0 };
+        std::atomic<uint64_t> _dropped{ 0 };
+        std::atomic<uint64_t> _completed{ 0 };
+        // Guarded by `_mutex`.
+        OpenLoopStats _statsAtReset;
     };
 
     // Returns total count of type remaining after deletion.
@@ -214,6 +659,9 @@ private:
 
     const std::function<std::unique_ptr<Workload>()> _createCallback;
 
+    BlockingCallOptions _blockingCall;
+    std::shared_ptr<const DataFile> _dataFile;
+
     std::vector<std::unique_ptr<ThreadWorkload>> _workloads;
 };
 
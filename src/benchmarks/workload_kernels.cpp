@@ -0,0 +1,263 @@
+#include "benchmarks/workload_kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <immintrin.h>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <x86intrin.h>
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+unsigned getCoreId() {
+    unsigned id;
+    __rdtscp(&id);
+    return id;
+}
+
+// Counts a migration when the unit of work ended on another core.
+class MigrationCounter {
+public:
+    int migrations() const {
+        return getCoreId() != _startCoreId;
+    }
+
+private:
+    const unsigned _startCoreId = getCoreId();
+};
+
+constexpr int kSimdValues = 4096;
+constexpr int kSimdRounds = 256;
+
+// Every kernel runs `kSimdRounds` dependent FMAs per value with four independent
+// chains to keep the FMA units busy.
+__attribute__((target("avx512f"))) void simdKernelAvx512(float* values) {
+    const __m512 a = _mm512_set1_ps(0.999f);
+    const __m512 b = _mm512_set1_ps(0.001f);
+    for (int i = 0; i < kSimdValues; i += 64) {
+        __m512 v0 = _mm512_load_ps(values + i);
+        __m512 v1 = _mm512_load_ps(values + i + 16);
+        __m512 v2 = _mm512_load_ps(values + i + 32);
+        __m512 v3 = _mm512_load_ps(values + i + 48);
+        for (int round = 0; round < kSimdRounds; ++round) {
+            v0 = _mm512_fmadd_ps(v0, a, b);
+            v1 = _mm512_fmadd_ps(v1, a, b);
+            v2 = _mm512_fmadd_ps(v2, a, b);
+            v3 = _mm512_fmadd_ps(v3, a, b);
+        }
+        _mm512_store_ps(values + i, v0);
+        _mm512_store_ps(values + i + 16, v1);
+        _mm512_store_ps(values + i + 32, v2);
+        _mm512_store_ps(values + i + 48, v3);
+    }
+}
+
+__attribute__((target("avx2,fma"))) void simdKernelAvx2(float* values) {
+    const __m256 a = _mm256_set1_ps(0.999f);
+    const __m256 b = _mm256_set1_ps(0.001f);
+    for (int i = 0; i < kSimdValues; i += 32) {
+        __m256 v0 = _mm256_load_ps(values + i);
+        __m256 v1 = _mm256_load_ps(values + i + 8);
+        __m256 v2 = _mm256_load_ps(values + i + 16);
+        __m256 v3 = _mm256_load_ps(values + i + 24);
+        for (int round = 0; round < kSimdRounds; ++round) {
+            v0 = _mm256_fmadd_ps(v0, a, b);
+            v1 = _mm256_fmadd_ps(v1, a, b);
+            v2 = _mm256_fmadd_ps(v2, a, b);
+            v3 = _mm256_fmadd_ps(v3, a, b);
+        }
+        _mm256_store_ps(values + i, v0);
+        _mm256_store_ps(values + i + 8, v1);
+        _mm256_store_ps(values + i + 16, v2);
+        _mm256_store_ps(values + i + 24, v3);
+    }
+}
+
+void simdKernelScalar(float* values) {
+    for (int i = 0; i < kSimdValues; i += 4) {
+        float v0 = values[i], v1 = values[i + 1], v2 = values[i + 2], v3 = values[i + 3];
+        for (int round = 0; round < kSimdRounds; ++round) {
+            v0 = v0 * 0.999f + 0.001f;
+            v1 = v1 * 0.999f + 0.001f;
+            v2 = v2 * 0.999f + 0.001f;
+            v3 = v3 * 0.999f + 0.001f;
+        }
+        values[i] = v0;
+        values[i + 1] = v1;
+        values[i + 2] = v2;
+        values[i + 3] = v3;
+    }
+}
+
+using SimdKernel = void (*)(float*);
+
+SimdKernel selectSimdKernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return simdKernelAvx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return simdKernelAvx2;
+    }
+    return simdKernelScalar;
+}
+
+// 3 arrays of 128 MiB, a unit of work streams through 2 MiB of each.
+constexpr size_t kStreamArraySize = size_t{ 16 } << 20;
+constexpr size_t kStreamChunkSize = size_t{ 256 } << 10;
+
+// 64 MiB of cache lines, a unit of work visits 4096 of them.
+constexpr size_t kChaseNodes = size_t{ 1 } << 20;
+constexpr int kChaseHops = 4096;
+
+constexpr int kAllocationsPerUnit = 2000;
+constexpr int kMaxAllocationSize = 4096;
+
+constexpr int kConvoyLocks = 4;
+constexpr int kCriticalSectionsPerUnit = 200;
+constexpr int kCriticalSectionWork = 200;
+
+}  // namespace
+
+int SimdComputeWorkload::unitOfWork() {
+    static const SimdKernel kernel = selectSimdKernel();
+    alignas(64) static thread_local std::array<float, kSimdValues> values = [] {
+        std::array<float, kSimdValues> initial;
+        std::iota(initial.begin(), initial.end(), 0.0f);
+        return initial;
+    }();
+    MigrationCounter migrations;
+    kernel(values.data());
+    return migrations.migrations();
+}
+
+std::mutex MemoryStreamWorkload::_mutex;
+std::vector<double>* MemoryStreamWorkload::_a;
+std::vector<double>* MemoryStreamWorkload::_b;
+std::vector<double>* MemoryStreamWorkload::_c;
+
+void MemoryStreamWorkload::init(const Config& config) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (_a) {
+        return;
+    }
+    _a = new std::vector<double>(kStreamArraySize, 0.0);
+    _b = new std::vector<double>(kStreamArraySize, 1.0);
+    _c = new std::vector<double>(kStreamArraySize, 2.0);
+}
+
+int MemoryStreamWorkload::unitOfWork() {
+    assert(_a);
+    // Threads start at random chunks, which makes it unlikely but not impossible that two
+    // of them stream through the same lines at once. Concurrent writes of `a` race, the
+    // results are never read.
+    static thread_local size_t offset =
+        std::random_device()() % (kStreamArraySize / kStreamChunkSize) * kStreamChunkSize;
+    MigrationCounter migrations;
+    double* a = _a->data() + offset;
+    const double* b = _b->data() + offset;
+    const double* c = _c->data() + offset;
+    for (size_t i = 0; i < kStreamChunkSize; ++i) {
+        a[i] = b[i] + 3.0 * c[i];
+    }
+    offset = (offset + kStreamChunkSize) % kStreamArraySize;
+    return migrations.migrations();
+}
+
+std::mutex PointerChaseWorkload::_mutex;
+std::vector<PointerChaseWorkload::Node>* PointerChaseWorkload::_nodes;
+
+void PointerChaseWorkload::init(const Config& config) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (_nodes) {
+        return;
+    }
+    // Sattolo's algorithm makes a single cycle through all nodes.
+    std::vector<uint32_t> order(kChaseNodes);
+    std::iota(order.begin(), order.end(), 0);
+    std::mt19937 gen;
+    for (size_t i = kChaseNodes - 1; i > 0; --i) {
+        std::uniform_int_distribution<size_t> distrib(0, i - 1);
+        std::swap(order[i], order[distrib(gen)]);
+    }
+    _nodes = new std::vector<Node>(kChaseNodes);
+    for (size_t i = 0; i < kChaseNodes; ++i) {
+        (*_nodes)[i].next = order[i];
+    }
+}
+
+int PointerChaseWorkload::unitOfWork() {
+    assert(_nodes);
+    static thread_local uint32_t position = std::random_device()() % kChaseNodes;
+    MigrationCounter migrations;
+    const Node* nodes = _nodes->data();
+    uint32_t current = position;
+    for (int hop = 0; hop < kChaseHops; ++hop) {
+        current = nodes[current].next;
+    }
+    position = current;
+    return migrations.migrations();
+}
+
+int AllocationWorkload::unitOfWork() {
+    static thread_local std::mt19937 gen;
+    static thread_local std::vector<std::unique_ptr<char[]>> survivors;
+    std::uniform_int_distribution<int> sizeDistrib(16, kMaxAllocationSize);
+    MigrationCounter migrations;
+
+    std::vector<std::unique_ptr<char[]>> allocations;
+    allocations.reserve(kAllocationsPerUnit);
+    for (int i = 0; i < kAllocationsPerUnit; ++i) {
+        int size = sizeDistrib(gen);
+        auto allocation = std::make_unique<char[]>(size);
+        // Touch both ends so the pages are really used.
+        allocation[0] = i;
+        allocation[size - 1] = i;
+        allocations.push_back(std::move(allocation));
+    }
+    // Free in random order, keep half alive until the next unit of work of this thread
+    // to fragment the heap.
+    std::shuffle(allocations.begin(), allocations.end(), gen);
+    survivors.clear();
+    for (int i = 0; i < kAllocationsPerUnit / 2; ++i) {
+        survivors.push_back(std::move(allocations[i]));
+    }
+    return migrations.migrations();
+}
+
+int LockConvoyWorkload::unitOfWork() {
+    return withLockType(_lockKind, [this](auto lockType) {
+        return _unitOfWork<typename decltype(lockType)::type>();
+    });
+}
+
+template <typename Lock>
+int LockConvoyWorkload::_unitOfWork() {
+    struct alignas(64) PaddedMutex {
+        Lock mutex;
+        uint64_t protectedValue = 0;
+    };
+    static std::array<PaddedMutex, kConvoyLocks> locks;
+    static thread_local std::mt19937 gen;
+    std::uniform_int_distribution<int> lockDistrib(0, kConvoyLocks - 1);
+    MigrationCounter migrations;
+
+    for (int i = 0; i < kCriticalSectionsPerUnit; ++i) {
+        auto& lock = locks[lockDistrib(gen)];
+        std::lock_guard<Lock> guard(lock.mutex);
+        uint64_t value = lock.protectedValue;
+        for (int j = 0; j < kCriticalSectionWork; ++j) {
+            value = value * 6364136223846793005ull + 1442695040888963407ull;
+        }
+        lock.protectedValue = value;
+    }
+    return migrations.migrations();
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "benchmarks/workload.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+// Workloads that each saturate one resource. Like `ContinuousWorkload` they keep shared
+// data in statics built by the first `init()` and per thread state in thread locals,
+// `unitOfWork()` may be called concurrently by the threads of a pool.
+
+// Chains of fused multiply-adds on an L1 resident array, AVX-512 or AVX2 when the CPU
+// has them and a scalar loop otherwise.
+class SimdComputeWorkload : public Workload {
+public:
+    void init(const Config& config) override {}
+
+    int unitOfWork() override;
+};
+
+// STREAM triad over arrays much larger than the last level cache.
+class MemoryStreamWorkload : public Workload {
+public:
+    void init(const Config& config) override;
+
+    int unitOfWork() override;
+
+private:
+    static std::mutex _mutex;
+    static std::vector<double>* _a;
+    static std::vector<double>* _b;
+    static std::vector<double>* _c;
+};
+
+// Dependent loads along a random cycle of cache lines, every hop is a cache miss.
+class PointerChaseWorkload : public Workload {
+public:
+    void init(const Config& config) override;
+
+    int unitOfWork() override;
+
+private:
+    struct alignas(64) Node {
+        uint32_t next;
+    };
+
+    static std::mutex _mutex;
+    static std::vector<Node>* _nodes;
+};
+
+// Allocates and frees objects of random sizes, half of them outlive the unit of work.
+class AllocationWorkload : public Workload {
+public:
+    void init(const Config& config) override {}
+
+    int unitOfWork() override;
+};
+
+// Short critical sections on a handful of global mutexes, waiters queue up behind
+// every holder.
+class LockConvoyWorkload : public Workload {
+public:
+    void init(const Config& config) override {
+        _lockKind = config.shardLock;
+    }
+
+    int unitOfWork() override;
+
+private:
+    template <typename Lock>
+    int _unitOfWork();
+
+    LockKind _lockKind = LockKind::kMutex;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,76 @@
+#include "benchmarks/workload_registry.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "benchmarks/continuous_workload.h"
+#include "benchmarks/workload_kernels.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+namespace {
+
+template <typename W>
+WorkloadRegistry::Factory factoryOf() {
+    return [] { return std::make_unique<W>(); };
+}
+
+}  // namespace
+
+WorkloadRegistry& WorkloadRegistry::instance() {
+    static WorkloadRegistry* registry = [] {
+        auto* registry = new WorkloadRegistry();
+        registry->add(kDefaultWorkload, factoryOf<ContinuousWorkload>());
+        registry->add("simd", factoryOf<SimdComputeWorkload>());
+        registry->add("stream", factoryOf<MemoryStreamWorkload>());
+        registry->add("pointerChase", factoryOf<PointerChaseWorkload>());
+        registry->add("alloc", factoryOf<AllocationWorkload>());
+        registry->add("lockConvoy", factoryOf<LockConvoyWorkload>());
+        return registry;
+    }();
+    return *registry;
+}
+
+void WorkloadRegistry::add(const std::string& name, Factory factory) {
+    auto [it, inserted] = _factories.emplace(name, std::move(factory));
+    assert(inserted);
+}
+
+bool WorkloadRegistry::contains(const std::string& name) const {
+    return _factories.count(name) > 0;
+}
+
+std::vector<std::string> WorkloadRegistry::names() const {
+    std::vector<std::string> result;
+    for (const auto& [name, factory] : _factories) {
+        result.push_back(name);
+    }
+    return result;
+}
+
+std::unique_ptr<Workload> WorkloadRegistry::create(const Config& config) const {
+    auto it = _factories.find(config.workload);
+    assert(it != _factories.end());
+    auto workload = it->second();
+    workload->init(config);
+    return workload;
+}
+
+std::string WorkloadRegistry::workloadFromCommandLine(int* argc, char** argv) {
+    std::string workload = kDefaultWorkload;
+    int kept = 1;
+    for (int i = 1; i < *argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--workload=", 0) == 0) {
+            workload = arg.substr(strlen("--workload="));
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    *argc = kept;
+    return workload;
+}
+
+}  // namespace testing
+}  // namespace blocking_to_async
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmarks/workload.h"
+
+namespace blocking_to_async {
+namespace testing {
+
+// Workloads selectable by name, `Config::workload` picks the one the benchmarks run.
+class WorkloadRegistry {
+public:
+    using Factory = std::function<std::unique_ptr<Workload>()>;
+
+    static constexpr const char* kDefaultWorkload = "continuous";
+
+    // The registry with all workloads of this directory.
+    static WorkloadRegistry& instance();
+
+    void add(const std::string& name, Factory factory);
+
+    bool contains(const std::string& name) const;
+
+    std::vector<std::string> names() const;
+
+    // Creates and initializes the workload named by `config.workload`, which must exist.
+    std::unique_ptr<Workload> create(const Config& config) const;
+
+    // Removes `--workload=<name>` from the command line and returns the name, the
+    // default workload if the flag is absent.
+    static std::string workloadFromCommandLine(int* argc, char** argv);
+
+private:
+    std::map<std::string, Factory> _factories;
+};
+
+}  // namespace testing
+}  // namespace blocking_to_async